@@ -3,6 +3,7 @@
 #include "MiSpiAnalyzerSettings.h"
 
 #include <AnalyzerChannelData.h>
+#include <AnalyzerHelpers.h>
 
 
 // enum SpiBubbleType { SpiData, SpiError };
@@ -12,8 +13,21 @@ MiSpiAnalyzer::MiSpiAnalyzer()
       mSettings( new MiSpiAnalyzerSettings() ),
       mSimulationInitilized( false ),
       mData( NULL ),
-      mClock( NULL )
+      mClock( NULL ),
+      mPacketStart( 0 ),
+      mPacketEnd( 0 ),
+      mPacketStartPulseEnd( 0 ),
+      mPacketHeld( false ),
+      mRepeatStart( 0 ),
+      mRepeatEnd( 0 ),
+      mRepeatLastDirection( MiSpiDirUnknown )
 {
+    for( int i = 0; i < 2; i++ )
+    {
+        mHaveLastPacket[ i ] = false;
+        mRepeatCount[ i ] = 0;
+    }
+
     SetAnalyzerSettings( mSettings.get() );
     UseFrameV2();
 }
@@ -36,6 +50,26 @@ void MiSpiAnalyzer::WorkerThread()
     // Setup
     mData = GetAnalyzerChannelData( mSettings->mDataChannel );
     mClock = GetAnalyzerChannelData( mSettings->mClockChannel );
+
+    // Pick the decode loop built for this word width and bit order
+    bool msb_first = mSettings->mShiftOrder == AnalyzerEnums::MsbFirst;
+    switch( mSettings->mBitsPerWord )
+    {
+    case 16:
+        msb_first ? DecodeWords<16, AnalyzerEnums::MsbFirst>() : DecodeWords<16, AnalyzerEnums::LsbFirst>();
+        break;
+    case 32:
+        msb_first ? DecodeWords<32, AnalyzerEnums::MsbFirst>() : DecodeWords<32, AnalyzerEnums::LsbFirst>();
+        break;
+    default:
+        msb_first ? DecodeWords<8, AnalyzerEnums::MsbFirst>() : DecodeWords<8, AnalyzerEnums::LsbFirst>();
+        break;
+    }
+}
+
+template <U32 BitsPerWord, AnalyzerEnums::ShiftOrder ShiftOrder>
+void MiSpiAnalyzer::DecodeWords()
+{
     U32 mSampleRateHz = GetSampleRate();
 
     // TODO - Variablize these
@@ -47,12 +81,47 @@ void MiSpiAnalyzer::WorkerThread()
     U32 mBitLowUs = 8;
     U32 mSyncHighUs = 270 - mStartTol;
     U32 mClockTimeoutUs = 300;
+    U32 mIdleUs = 10000;
+    U64 idle_samples = ( U64 )mIdleUs * mSampleRateHz / 1000000;
 
     // State machine variables
-    U8 bit_count = 0;
-    U8 data = 0;
+    U32 bit_count = 0;
+    U64 data = 0;
     U64 byte_start = 0;
     MiSpiDirection direction = MiSpiDirUnknown;
+    mPacket.clear();
+
+    // Timing statistics, gaps are only measured between words or packets that follow each other
+    U64 word_end = 0;
+    bool word_gap_valid = false;
+    bool packet_gap_valid = false;
+    U32 timing_pulses = 0;
+    for (int i = 0; i < MiSpiTimingMetricCount; i++) {
+        mTiming[ i ].Clear();
+    }
+    mPacketHeld = false;
+    mRepeatCount[ MiSpiDirMosi ] = 0;
+    mRepeatCount[ MiSpiDirMiso ] = 0;
+    ResetRepeats(MiSpiDirMosi);
+    ResetRepeats(MiSpiDirMiso);
+
+    // Decode cache, recording or playing back starts once the capture has been recognised
+    U64 pulses = 0;
+    U64 last_pulse_end = 0;
+    U64 checkpoint_pulses = 0;
+    std::vector<MiSpiPulse> walked_pulses;
+    size_t walked_next = 0;
+    SimpleArchive decode_settings;
+    decode_settings << mSettings->mDataChannel;
+    decode_settings << mSettings->mClockChannel;
+    decode_settings << mSettings->mShiftOrder;
+    decode_settings << mSettings->mCollapseRepeats;
+    decode_settings << mSettings->mBitsPerWord;
+    mDecodeCache.Reset(mSettings->mDecodeCacheFolder, decode_settings.GetString(), GetSampleRate());
+
+    // The first pulses are always read from the channels and checked against the timeline
+    bool record_timeline = true;
+    mPulseTimeline.Prepare(mSettings->mDataChannel, mSettings->mClockChannel, GetSampleRate());
 
     // Wait for the clock to go low before we start analyzing anything
     if( mClock->GetBitState() == BIT_HIGH )
@@ -60,14 +129,136 @@ void MiSpiAnalyzer::WorkerThread()
 
     for( ; ; )
     {
-        // setup v2 frame for tables
-        FrameV2 framev2;
+        // Pulses read while checking the decode cache against the capture are decoded first. Pulses an earlier
+        // decode saw come from the timeline, the channels are only walked past its end
+        bool from_walk = walked_next < walked_pulses.size();
+        bool from_timeline = !from_walk && pulses >= MISPI_TIMELINE_CHECK_PULSES && mPulseTimeline.HasNext();
+        if (!mPulseTimeline.HasNext() && mClock->GetSampleNumber() < mPulseTimeline.GetEnd()) {
+            mClock->AdvanceToAbsPosition(mPulseTimeline.GetEnd());
+        }
+        bool caught_up = !from_walk && !from_timeline && !mClock->DoMoreTransitionsExistInCurrentData();
+
+        // Catching up with a live capture happens between any two pulses, the bus has only gone quiet once
+        // there's no clock edge for a while after the last one
+        bool idle = caught_up && !mClock->WouldAdvancingToAbsPositionCauseTransition(mClock->GetSampleNumber() + idle_samples);
+
+        // Play back the rest of the capture if it's been decoded before
+        if (mDecodeCache.IsFingerprinting()) {
+            if (idle) {
+                mDecodeCache.CancelFingerprint();
+            } else if (pulses == MISPI_CACHE_FINGERPRINT_PULSES) {
+                MiSpiDecodeCheckpoint boundary;
+                boundary.mSample = last_pulse_end;
+                boundary.mPulses = pulses;
+                boundary.mBitCount = bit_count;
+                boundary.mData = data;
+                boundary.mWordStart = byte_start;
+                boundary.mDirection = direction;
+                boundary.mWordEnd = word_end;
+                boundary.mWordGapValid = word_gap_valid;
+                boundary.mPacketGapValid = packet_gap_valid;
+                SaveCheckpoint(boundary);
+                MiSpiDecodeCheckpoint checkpoint = boundary;
+                bool played = mDecodeCache.Load(boundary) && ReplayDecodeCache(checkpoint, walked_pulses);
+                walked_next = 0;
+
+                // The pulses played back or walked past won't be in the timeline, so it can't be kept
+                if (played || !walked_pulses.empty()) {
+                    mPulseTimeline.Clear();
+                    record_timeline = false;
+                }
+                if (!played) {
+                    checkpoint_pulses = pulses;
+                    continue;
+                }
 
-        // Get the next clock pulse
-        mClock->AdvanceToNextEdge(); //leading edge
-        U64 clock_start = mClock->GetSampleNumber();
-        mClock->AdvanceToNextEdge(); //trailing edge
-        U64 clock_end = mClock->GetSampleNumber();
+                bit_count = checkpoint.mBitCount;
+                data = checkpoint.mData;
+                byte_start = checkpoint.mWordStart;
+                direction = checkpoint.mDirection;
+                word_end = checkpoint.mWordEnd;
+                word_gap_valid = checkpoint.mWordGapValid;
+                packet_gap_valid = checkpoint.mPacketGapValid;
+                pulses = checkpoint.mPulses;
+                checkpoint_pulses = pulses;
+                timing_pulses = 0;
+                last_pulse_end = checkpoint.mSample;
+                continue;
+            }
+        }
+
+        // Statistics go over in blocks of pulses, and what's left of them when the bus goes quiet, so the
+        // percentiles are complete at the end of the decode without merging them after every pulse
+        if( timing_pulses >= 0x10000 || ( idle && timing_pulses > 0 ) )
+        {
+            mResults->AddTiming(mTiming);
+            if (mDecodeCache.IsRecording()) {
+                mDecodeCache.AddTiming(last_pulse_end, mTiming);
+            }
+            for (int i = 0; i < MiSpiTimingMetricCount; i++) {
+                mTiming[ i ].Clear();
+            }
+            timing_pulses = 0;
+
+            // The cache is checkpointed along with the timing, so nothing before a checkpoint is missing from it
+            if (mDecodeCache.IsRecording() && pulses != checkpoint_pulses) {
+                MiSpiDecodeCheckpoint checkpoint;
+                checkpoint.mSample = last_pulse_end;
+                checkpoint.mPulses = pulses;
+                checkpoint.mBitCount = bit_count;
+                checkpoint.mData = data;
+                checkpoint.mWordStart = byte_start;
+                checkpoint.mDirection = direction;
+                checkpoint.mWordEnd = word_end;
+                checkpoint.mWordGapValid = word_gap_valid;
+                checkpoint.mPacketGapValid = packet_gap_valid;
+                SaveCheckpoint(checkpoint);
+                mDecodeCache.AddCheckpoint(checkpoint);
+                checkpoint_pulses = pulses;
+            }
+        }
+
+        // Don't sit on held back results once the bus has gone quiet, a run of repeats would only be split
+        // every time decoding catches up. The checkpoint above keeps them held, so a decode carrying on from
+        // it folds the repeats the same way as one that never stopped
+        if( idle )
+        {
+            FlushRepeats();
+            ReleasePacket(direction);
+        }
+
+        // Get the next clock pulse, and the state of the data line where it ends
+        U64 clock_start;
+        U64 clock_end;
+        U64 bit;
+        if (from_walk) {
+            const MiSpiPulse& pulse = walked_pulses[walked_next++];
+            clock_start = pulse.mStartingSampleInclusive;
+            clock_end = pulse.mEndingSampleInclusive;
+            bit = pulse.mBit;
+        } else if (from_timeline) {
+            mPulseTimeline.Read(clock_start, clock_end, bit);
+        } else {
+            mClock->AdvanceToNextEdge(); //leading edge
+            clock_start = mClock->GetSampleNumber();
+            mClock->AdvanceToNextEdge(); //trailing edge
+            clock_end = mClock->GetSampleNumber();
+            mData->AdvanceToAbsPosition(clock_end);
+            bit = mData->GetBitState() == BIT_HIGH;
+
+            // A timeline that doesn't start the same way is from some other capture
+            U64 timeline_start;
+            U64 timeline_end;
+            U64 timeline_bit;
+            if (mPulseTimeline.Read(timeline_start, timeline_end, timeline_bit)) {
+                if (timeline_start != clock_start || timeline_end != clock_end || timeline_bit != bit) {
+                    mPulseTimeline.Clear();
+                    record_timeline = false;
+                }
+            } else if (record_timeline) {
+                mPulseTimeline.Append(clock_start, clock_end, bit);
+            }
+        }
 
         // Move the progress bar along
         ReportProgress( clock_end ); 
@@ -75,42 +266,40 @@ void MiSpiAnalyzer::WorkerThread()
         // How long was that?
         U64 clock_length_samples = clock_end - clock_start;
         U64 clock_duration_us = ( clock_length_samples * 1000000 ) / mSampleRateHz;
+        timing_pulses++;
+        pulses++;
+        last_pulse_end = clock_end;
+        if (mDecodeCache.IsFingerprinting()) {
+            mDecodeCache.AddToFingerprint(clock_start);
+            mDecodeCache.AddToFingerprint(clock_end);
+        }
 
         if (clock_duration_us > mClockTimeoutUs) {
             // Invalid pulse, let's reset the state machine
+            ClosePacket(direction);
+            packet_gap_valid = false;
+            word_gap_valid = false;
+            ResetRepeats(direction);
             bit_count = 0;
             data = 0;
             direction = MiSpiDirUnknown;
-            mResults->CancelPacketAndStartNewPacket();
-
-            Frame frame;
-            frame.mFlags = 0;
-            frame.mData1 = 0;
-            frame.mType = MiSpiError;
-            FinalizeFrame(frame, clock_start, clock_end);
+            EmitError(clock_start, clock_end);
 
         } else if (clock_duration_us > mSyncHighUs) {
             // Record Sync Pulse, reset state machine
+            mTiming[ MiSpiTimingSyncPulse ].Add(clock_length_samples);
+            ClosePacket(direction);
+            packet_gap_valid = false;
+            word_gap_valid = false;
+            ResetRepeats(direction);
             bit_count = 0;
             data = 0;
             direction = MiSpiDirUnknown;
-            mResults->CancelPacketAndStartNewPacket();
-
-            Frame frame;
-            frame.mFlags = 0;
-            frame.mData1 = 0;
-            frame.mType = MiSpiSync;
-            FinalizeFrame(frame, clock_start, clock_end);
-
-            mResults->AddFrameV2(framev2, "Sync", clock_start, clock_end);
-            mResults->CommitResults();
+            EmitSync(clock_start, clock_end);
 
         } else if (clock_duration_us > mStartMosiHighUs) {
             // Record MOSI start
 
-            // Add Marker
-            mResults->AddMarker(clock_end, AnalyzerResults::Start, mSettings->mClockChannel);
-
             // Reset byte data
             bit_count = 0;
             data = 0;
@@ -125,26 +314,22 @@ void MiSpiAnalyzer::WorkerThread()
             // }
             // mResults->CommitResults();
 
+            mTiming[ MiSpiTimingMosiStartPulse ].Add(clock_length_samples);
+            if (packet_gap_valid && direction != MiSpiDirUnknown) {
+                mTiming[ MiSpiTimingPacketGap ].Add(clock_start - mPacketEnd);
+            }
+            packet_gap_valid = true;
+            word_gap_valid = false;
+
+            // The previous packet is complete, this one starts with the start pulse
+            ClosePacket(direction);
+
             // Update direction
             direction = MiSpiDirMosi;
-
-            // Configure frame v1
-            Frame frame;
-            frame.mFlags = 0;
-            frame.mData1 = 0;
-            frame.mType = MiSpiStartMosi;
-            FinalizeFrame(frame, clock_start, clock_end);
-
-            // Configure frame v2
-            framev2.AddString("Direction", "MOSI");
-            mResults->AddFrameV2(framev2, "Start", clock_start, clock_end);
-            mResults->CommitResults();
+            OpenPacket(direction, clock_start, clock_end);
         } else if (clock_duration_us > mStartMisoHighUs) {
             // Record MISO start
 
-            // Add Marker
-            mResults->AddMarker(clock_end, AnalyzerResults::Stop, mSettings->mClockChannel);
-
             // Reset byte data
             bit_count = 0;
             data = 0;
@@ -157,63 +342,51 @@ void MiSpiAnalyzer::WorkerThread()
             // }
             // mResults->CommitResults();
 
+            mTiming[ MiSpiTimingMisoStartPulse ].Add(clock_length_samples);
+            if (packet_gap_valid && direction != MiSpiDirUnknown) {
+                mTiming[ MiSpiTimingPacketGap ].Add(clock_start - mPacketEnd);
+            }
+            packet_gap_valid = true;
+            word_gap_valid = false;
+
+            // The previous packet is complete, this one starts with the start pulse
+            ClosePacket(direction);
+
             // Update direction
             direction = MiSpiDirMiso;
-
-            // Configure frame v1
-            Frame frame;
-            frame.mFlags = 0;
-            frame.mData1 = 0;
-            frame.mType = MiSpiStartMiso;
-            FinalizeFrame(frame, clock_start, clock_end);
-
-            // Configure frame v2
-            framev2.AddString("Direction", "MISO");
-            mResults->AddFrameV2(framev2, "Start", clock_start, clock_end);
-            mResults->CommitResults();
+            OpenPacket(direction, clock_start, clock_end);
         } else {
             // Record bit
+            mTiming[ MiSpiTimingBitPulse ].Add(clock_length_samples);
 
             // Add Marker
-            mResults->AddMarker(clock_end, AnalyzerResults::DownArrow, mSettings->mClockChannel);
+            AddBitMarker(clock_end);
 
-            // Determine if this edge is a 1 or a 0
-            mData->AdvanceToAbsPosition(clock_end);
-            if( mData->GetBitState() == BIT_HIGH ) {
-                if (mSettings->mShiftOrder == AnalyzerEnums::MsbFirst) {
-                    data |= (128 >> bit_count);
-                } else {
-                    data |= (1 << bit_count);
-                }
-            } 
+            // Determine if this edge is a 1 or a 0, the bit order is fixed at compile time
+            if (mDecodeCache.IsFingerprinting()) {
+                mDecodeCache.AddToFingerprint(bit);
+            }
+            if (ShiftOrder == AnalyzerEnums::MsbFirst) {
+                data = (data << 1) | bit;
+            } else {
+                data |= bit << bit_count;
+            }
 
-            // Handle starting a new byte
+            // Handle starting a new word
             if (bit_count == 0) {
                 byte_start = clock_start;
+                if (word_gap_valid) {
+                    mTiming[ MiSpiTimingWordGap ].Add(clock_start - word_end);
+                }
             }
 
             bit_count++;
 
-            // Handle ending a byte
-            if (bit_count == 8) {
-                // Frame v1
-                Frame frame;
-                frame.mFlags = 0;
-                frame.mData1 = data; 
-                frame.mType = MiSpiData;
-                FinalizeFrame(frame, byte_start, clock_end);
-
-                // Frame v2
-                framev2.AddByte("Data", data);
-                if (direction == MiSpiDirMiso) {
-                    framev2.AddString("Direction", "MISO");
-                } else if (direction == MiSpiDirMosi) {
-                    framev2.AddString("Direction", "MOSI");
-                } else {
-                    framev2.AddString("Direction", "Unknown");
-                } 
-                mResults->AddFrameV2(framev2, "Data", byte_start, clock_end);
-                mResults->CommitResults();
+            // Handle ending a word
+            if (bit_count == BitsPerWord) {
+                AddWord(direction, data, byte_start, clock_end);
+                word_end = clock_end;
+                word_gap_valid = direction != MiSpiDirUnknown;
 
                 // Reset byte data
                 bit_count = 0;
@@ -231,6 +404,408 @@ void MiSpiAnalyzer::FinalizeFrame(Frame frame, U64 start, U64 end)
     mResults->CommitResults();
 }
 
+// A packet is held back while collapsing repeats, until we know whether it repeats the last one
+void MiSpiAnalyzer::OpenPacket(MiSpiDirection direction, U64 start, U64 end)
+{
+    mPacket.clear();
+    mPacketWords.clear();
+    mPacketBitMarkers.clear();
+    mPacketStart = start;
+    mPacketEnd = end;
+    mPacketStartPulseEnd = end;
+    mPacketHeld = mSettings->mCollapseRepeats;
+
+    if (!mPacketHeld) {
+        EmitStart(direction, start, end);
+    }
+}
+
+void MiSpiAnalyzer::AddBitMarker(U64 sample)
+{
+    if (mPacketHeld) {
+        mPacketBitMarkers.push_back(sample);
+    } else {
+        EmitBitMarker(sample);
+    }
+}
+
+void MiSpiAnalyzer::AddWord(MiSpiDirection direction, U64 data, U64 start, U64 end)
+{
+    if (direction != MiSpiDirUnknown) {
+        MiSpiAppendWordBytes(mPacket, data, mSettings->mBitsPerWord);
+        mPacketEnd = end;
+    }
+
+    if (mPacketHeld) {
+        MiSpiWord word;
+        word.mData = data;
+        word.mStartingSampleInclusive = start;
+        word.mEndingSampleInclusive = end;
+        mPacketWords.push_back(word);
+    } else {
+        EmitWord(direction, data, start, end);
+    }
+}
+
+// The packet is complete, fold it into the current run of repeats or show it
+void MiSpiAnalyzer::ClosePacket(MiSpiDirection direction)
+{
+    if (direction == MiSpiDirUnknown) {
+        return;
+    }
+
+    bool folded = false;
+    if (mSettings->mCollapseRepeats) {
+        std::vector<U8>& last = mLastPacket[ direction ];
+        if (mPacketHeld && mHaveLastPacket[ direction ] && mPacket == last) {
+            if (mRepeatCount[ MiSpiDirMosi ] + mRepeatCount[ MiSpiDirMiso ] == 0) {
+                mRepeatStart = mPacketStart;
+            }
+            mRepeatEnd = mPacketEnd;
+            mRepeatLastDirection = direction;
+            mRepeatCount[ direction ]++;
+            mPacketHeld = false;
+            folded = true;
+        } else {
+            FlushRepeats();
+            ReleasePacket(direction);
+            last = mPacket;
+            mHaveLastPacket[ direction ] = true;
+        }
+    }
+
+    mResults->AddIndexedPacket(direction, mPacket, mPacketStart, mPacketEnd, folded);
+    if (mDecodeCache.IsRecording()) {
+        mDecodeCache.AddPacket(direction, mPacket, mPacketStart, mPacketEnd, folded);
+    }
+    mPacket.clear();
+}
+
+// Show a held back packet as is, anything still to come of it is shown straight away
+void MiSpiAnalyzer::ReleasePacket(MiSpiDirection direction)
+{
+    if (!mPacketHeld) {
+        return;
+    }
+    mPacketHeld = false;
+
+    EmitStart(direction, mPacketStart, mPacketStartPulseEnd);
+    for (U32 i = 0; i < mPacketBitMarkers.size(); i++) {
+        EmitBitMarker(mPacketBitMarkers[ i ]);
+    }
+    for (U32 i = 0; i < mPacketWords.size(); i++) {
+        EmitWord(direction, mPacketWords[ i ].mData, mPacketWords[ i ].mStartingSampleInclusive, mPacketWords[ i ].mEndingSampleInclusive);
+    }
+    mPacketWords.clear();
+    mPacketBitMarkers.clear();
+}
+
+// Record the packets folded so far as a single frame
+void MiSpiAnalyzer::FlushRepeats()
+{
+    U64 mosi_count = mRepeatCount[ MiSpiDirMosi ];
+    U64 miso_count = mRepeatCount[ MiSpiDirMiso ];
+    if (mosi_count + miso_count == 0) {
+        return;
+    }
+
+    U64 flags = ( mRepeatLastDirection == MiSpiDirMosi ) ? MISPI_REPEAT_ENDS_MOSI_FLAG : 0;
+    EmitRepeat(flags, mosi_count, miso_count, mRepeatStart, mRepeatEnd);
+
+    mRepeatCount[ MiSpiDirMosi ] = 0;
+    mRepeatCount[ MiSpiDirMiso ] = 0;
+}
+
+// Sync and errors end a run of repeats, and like in the export, the packet in the direction they interrupted
+void MiSpiAnalyzer::ResetRepeats(MiSpiDirection direction)
+{
+    FlushRepeats();
+    if (direction != MiSpiDirUnknown) {
+        mLastPacket[ direction ].clear();
+        mHaveLastPacket[ direction ] = false;
+    }
+}
+
+void MiSpiAnalyzer::EmitStart(MiSpiDirection direction, U64 start, U64 end)
+{
+    if (mDecodeCache.IsRecording()) {
+        mDecodeCache.AddStart(direction, start, end);
+    }
+
+    FrameV2 framev2;
+
+    // Add Marker
+    Frame frame;
+    frame.mFlags = 0;
+    frame.mData1 = 0;
+    if (direction == MiSpiDirMosi) {
+        mResults->AddMarker(end, AnalyzerResults::Start, mSettings->mClockChannel);
+        frame.mType = MiSpiStartMosi;
+        framev2.AddString("Direction", "MOSI");
+    } else {
+        mResults->AddMarker(end, AnalyzerResults::Stop, mSettings->mClockChannel);
+        frame.mType = MiSpiStartMiso;
+        framev2.AddString("Direction", "MISO");
+    }
+
+    // Frame v1
+    FinalizeFrame(frame, start, end);
+
+    // Frame v2
+    mResults->AddFrameV2(framev2, "Start", start, end);
+    mResults->CommitResults();
+}
+
+void MiSpiAnalyzer::EmitWord(MiSpiDirection direction, U64 data, U64 start, U64 end)
+{
+    if (mDecodeCache.IsRecording()) {
+        mDecodeCache.AddWord(direction, data, start, end);
+    }
+
+    // Frame v1
+    Frame frame;
+    frame.mFlags = 0;
+    frame.mData1 = data; 
+    frame.mType = MiSpiData;
+    FinalizeFrame(frame, start, end);
+
+    // Frame v2
+    FrameV2 framev2;
+    if (mSettings->mBitsPerWord == 8) {
+        framev2.AddByte("Data", data);
+    } else {
+        std::vector<U8> bytes;
+        MiSpiAppendWordBytes(bytes, data, mSettings->mBitsPerWord);
+        framev2.AddByteArray("Data", &bytes[ 0 ], bytes.size());
+    }
+    if (direction == MiSpiDirMiso) {
+        framev2.AddString("Direction", "MISO");
+    } else if (direction == MiSpiDirMosi) {
+        framev2.AddString("Direction", "MOSI");
+    } else {
+        framev2.AddString("Direction", "Unknown");
+    } 
+    mResults->AddFrameV2(framev2, "Data", start, end);
+    mResults->CommitResults();
+}
+
+void MiSpiAnalyzer::EmitBitMarker(U64 sample)
+{
+    if (mDecodeCache.IsRecording()) {
+        mDecodeCache.AddBitMarker(sample);
+    }
+
+    mResults->AddMarker(sample, AnalyzerResults::DownArrow, mSettings->mClockChannel);
+}
+
+void MiSpiAnalyzer::EmitSync(U64 start, U64 end)
+{
+    if (mDecodeCache.IsRecording()) {
+        mDecodeCache.AddSync(start, end);
+    }
+
+    mResults->CancelPacketAndStartNewPacket();
+
+    // Frame v1
+    Frame frame;
+    frame.mFlags = 0;
+    frame.mData1 = 0;
+    frame.mType = MiSpiSync;
+    FinalizeFrame(frame, start, end);
+
+    // Frame v2
+    FrameV2 framev2;
+    mResults->AddFrameV2(framev2, "Sync", start, end);
+    mResults->CommitResults();
+}
+
+void MiSpiAnalyzer::EmitError(U64 start, U64 end)
+{
+    if (mDecodeCache.IsRecording()) {
+        mDecodeCache.AddError(start, end);
+    }
+
+    mResults->CancelPacketAndStartNewPacket();
+
+    Frame frame;
+    frame.mFlags = 0;
+    frame.mData1 = 0;
+    frame.mType = MiSpiError;
+    FinalizeFrame(frame, start, end);
+}
+
+void MiSpiAnalyzer::EmitRepeat(U64 flags, U64 mosi_count, U64 miso_count, U64 start, U64 end)
+{
+    if (mDecodeCache.IsRecording()) {
+        mDecodeCache.AddRepeat(flags, mosi_count, miso_count, start, end);
+    }
+
+    // Frame v1
+    Frame frame;
+    frame.mFlags = flags;
+    frame.mData1 = mosi_count;
+    frame.mData2 = miso_count;
+    frame.mType = MiSpiRepeat;
+    FinalizeFrame(frame, start, end);
+
+    // Frame v2
+    FrameV2 framev2;
+    framev2.AddInteger("Count", mosi_count + miso_count);
+    framev2.AddInteger("MOSI", mosi_count);
+    framev2.AddInteger("MISO", miso_count);
+    mResults->AddFrameV2(framev2, "Repeat", start, end);
+    mResults->CommitResults();
+}
+
+// The capture was decoded with these settings before, show what was recorded instead of decoding it again.
+//
+// Each stretch of the recording is only shown once the clock has been walked up to the checkpoint that ends it and
+// the capture matches it there. Playback stops at the first one that doesn't, the checkpoint is left at the last
+// one that did and the pulses walked past it are left to be decoded. False if nothing was played back.
+bool MiSpiAnalyzer::ReplayDecodeCache(MiSpiDecodeCheckpoint& checkpoint, std::vector<MiSpiPulse>& walked_pulses)
+{
+    // The timeline may have stood in for the channels up to here
+    if (mClock->GetSampleNumber() < checkpoint.mSample) {
+        mClock->AdvanceToAbsPosition(checkpoint.mSample);
+    }
+
+    bool played = false;
+    MiSpiDecodeCheckpoint segment_end;
+    MiSpiDecodeRecord record;
+    while (mDecodeCache.NextSegment(segment_end)) {
+        if (!WalkToCheckpoint(checkpoint, segment_end, walked_pulses)) {
+            break;
+        }
+        walked_pulses.clear();
+
+        if (!played) {
+            // Whatever is held back or not handed over yet was recorded too
+            mPacketHeld = false;
+            mPacketWords.clear();
+            mPacketBitMarkers.clear();
+            mRepeatCount[ MiSpiDirMosi ] = 0;
+            mRepeatCount[ MiSpiDirMiso ] = 0;
+            for (int i = 0; i < MiSpiTimingMetricCount; i++) {
+                mTiming[ i ].Clear();
+            }
+            played = true;
+        }
+
+        while (mDecodeCache.ReadRecord(record)) {
+            U64 start = record.mStartingSampleInclusive;
+            U64 end = record.mEndingSampleInclusive;
+            switch (record.mType) {
+            case MiSpiRecordStart:
+                EmitStart(record.mDirection, start, end);
+                break;
+            case MiSpiRecordWord:
+                EmitWord(record.mDirection, record.mData1, start, end);
+                break;
+            case MiSpiRecordBitMarker:
+                EmitBitMarker(start);
+                break;
+            case MiSpiRecordSync:
+                EmitSync(start, end);
+                break;
+            case MiSpiRecordError:
+                EmitError(start, end);
+                break;
+            case MiSpiRecordRepeat:
+                EmitRepeat(record.mFlags, record.mData1, record.mData2, start, end);
+                break;
+            case MiSpiRecordPacket:
+                mResults->AddIndexedPacket(record.mDirection, record.mPayload, start, end, record.mFlags != 0);
+                break;
+            case MiSpiRecordTiming:
+                mResults->AddTiming(record.mTiming);
+                ReportProgress(end);
+                break;
+            case MiSpiRecordCheckpoint:
+                checkpoint = record.mCheckpoint;
+                ReportProgress(checkpoint.mSample);
+                break;
+            }
+        }
+    }
+
+    mDecodeCache.FinishReplay();
+    if (played) {
+        RestoreCheckpoint(checkpoint);
+    }
+    return played;
+}
+
+// Reads the clock pulses between two checkpoints from the channels. True if the capture has as many as were recorded,
+// and the last of them ends on the trailing edge the recording does.
+bool MiSpiAnalyzer::WalkToCheckpoint(const MiSpiDecodeCheckpoint& from, const MiSpiDecodeCheckpoint& to, std::vector<MiSpiPulse>& walked_pulses)
+{
+    walked_pulses.clear();
+    if (to.mPulses <= from.mPulses) {
+        return false;
+    }
+
+    for (U64 i = from.mPulses; i < to.mPulses; i++) {
+        // The recording goes on past what's been captured
+        if (!mClock->DoMoreTransitionsExistInCurrentData()) {
+            return false;
+        }
+
+        MiSpiPulse pulse;
+        mClock->AdvanceToNextEdge(); //leading edge
+        pulse.mStartingSampleInclusive = mClock->GetSampleNumber();
+        mClock->AdvanceToNextEdge(); //trailing edge
+        pulse.mEndingSampleInclusive = mClock->GetSampleNumber();
+        mData->AdvanceToAbsPosition(pulse.mEndingSampleInclusive);
+        pulse.mBit = mData->GetBitState() == BIT_HIGH;
+        walked_pulses.push_back(pulse);
+
+        if (pulse.mEndingSampleInclusive > to.mSample) {
+            return false;
+        }
+    }
+    ReportProgress(to.mSample);
+
+    return walked_pulses.back().mEndingSampleInclusive == to.mSample;
+}
+
+void MiSpiAnalyzer::SaveCheckpoint(MiSpiDecodeCheckpoint& checkpoint)
+{
+    checkpoint.mPacket = mPacket;
+    checkpoint.mPacketStart = mPacketStart;
+    checkpoint.mPacketEnd = mPacketEnd;
+    checkpoint.mPacketStartPulseEnd = mPacketStartPulseEnd;
+    for (int i = 0; i < 2; i++) {
+        checkpoint.mLastPacket[ i ] = mLastPacket[ i ];
+        checkpoint.mHaveLastPacket[ i ] = mHaveLastPacket[ i ];
+        checkpoint.mRepeatCount[ i ] = mRepeatCount[ i ];
+    }
+    checkpoint.mPacketHeld = mPacketHeld;
+    checkpoint.mPacketWords = mPacketWords;
+    checkpoint.mPacketBitMarkers = mPacketBitMarkers;
+    checkpoint.mRepeatStart = mRepeatStart;
+    checkpoint.mRepeatEnd = mRepeatEnd;
+    checkpoint.mRepeatLastDirection = mRepeatLastDirection;
+}
+
+void MiSpiAnalyzer::RestoreCheckpoint(const MiSpiDecodeCheckpoint& checkpoint)
+{
+    mPacket = checkpoint.mPacket;
+    mPacketStart = checkpoint.mPacketStart;
+    mPacketEnd = checkpoint.mPacketEnd;
+    mPacketStartPulseEnd = checkpoint.mPacketStartPulseEnd;
+    for (int i = 0; i < 2; i++) {
+        mLastPacket[ i ] = checkpoint.mLastPacket[ i ];
+        mHaveLastPacket[ i ] = checkpoint.mHaveLastPacket[ i ];
+        mRepeatCount[ i ] = checkpoint.mRepeatCount[ i ];
+    }
+    mPacketHeld = checkpoint.mPacketHeld;
+    mPacketWords = checkpoint.mPacketWords;
+    mPacketBitMarkers = checkpoint.mPacketBitMarkers;
+    mRepeatStart = checkpoint.mRepeatStart;
+    mRepeatEnd = checkpoint.mRepeatEnd;
+    mRepeatLastDirection = checkpoint.mRepeatLastDirection;
+}
+
 bool MiSpiAnalyzer::NeedsRerun()
 {
     return false;
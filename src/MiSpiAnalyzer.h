@@ -4,13 +4,8 @@
 #include <Analyzer.h>
 #include "MiSpiSimulationDataGenerator.h"
 #include "MiSpiAnalyzerResults.h"
-
-enum MiSpiDirection {
-  MiSpiDirMiso,
-  MiSpiDirMosi,
-  MiSpiDirUnknown
-};
-
+#include "MiSpiDecodeCache.h"
+#include "MiSpiPulseTimeline.h"
 
 class MiSpiAnalyzerSettings;
 class MiSpiAnalyzer : public Analyzer2
@@ -28,7 +23,26 @@ class MiSpiAnalyzer : public Analyzer2
     virtual bool NeedsRerun();
 
   protected: // functions
+    template <U32 BitsPerWord, AnalyzerEnums::ShiftOrder ShiftOrder>
+    void DecodeWords();
     void FinalizeFrame(Frame frame, U64 start, U64 end);
+    void OpenPacket(MiSpiDirection direction, U64 start, U64 end);
+    void AddBitMarker(U64 sample);
+    void AddWord(MiSpiDirection direction, U64 data, U64 start, U64 end);
+    void ClosePacket(MiSpiDirection direction);
+    void ReleasePacket(MiSpiDirection direction);
+    void FlushRepeats();
+    void ResetRepeats(MiSpiDirection direction);
+    void EmitStart(MiSpiDirection direction, U64 start, U64 end);
+    void EmitWord(MiSpiDirection direction, U64 data, U64 start, U64 end);
+    void EmitBitMarker(U64 sample);
+    void EmitSync(U64 start, U64 end);
+    void EmitError(U64 start, U64 end);
+    void EmitRepeat(U64 flags, U64 mosi_count, U64 miso_count, U64 start, U64 end);
+    bool ReplayDecodeCache(MiSpiDecodeCheckpoint& checkpoint, std::vector<MiSpiPulse>& walked_pulses);
+    bool WalkToCheckpoint(const MiSpiDecodeCheckpoint& from, const MiSpiDecodeCheckpoint& to, std::vector<MiSpiPulse>& walked_pulses);
+    void SaveCheckpoint(MiSpiDecodeCheckpoint& checkpoint);
+    void RestoreCheckpoint(const MiSpiDecodeCheckpoint& checkpoint);
 
 #pragma warning( push )
 #pragma warning(                                                                                                                           \
@@ -47,6 +61,34 @@ class MiSpiAnalyzer : public Analyzer2
     std::vector<U64> mArrowLocations;
     DataBuilder mDataResult;
 
+    // Packet being decoded, handed to the search index once it's complete
+    std::vector<U8> mPacket;
+    U64 mPacketStart;
+    U64 mPacketEnd;
+
+    // Results of the packet being decoded, while it's held back to see if it's a repeat
+    U64 mPacketStartPulseEnd;
+    bool mPacketHeld;
+    std::vector<MiSpiWord> mPacketWords;
+    std::vector<U64> mPacketBitMarkers;
+
+    // Last packet shown in each direction, and the repeats of them folded since
+    std::vector<U8> mLastPacket[ 2 ];
+    bool mHaveLastPacket[ 2 ];
+    U64 mRepeatCount[ 2 ];
+    U64 mRepeatStart;
+    U64 mRepeatEnd;
+    MiSpiDirection mRepeatLastDirection;
+
+    // Timing seen since the last time it was handed to the results
+    MiSpiTimingHistogram mTiming[ MiSpiTimingMetricCount ];
+
+    // Results recorded for, or played back from, the cache folder
+    MiSpiDecodeCache mDecodeCache;
+
+    // Pulses seen by earlier decodes of this capture, so running again doesn't walk the channels
+    MiSpiPulseTimeline mPulseTimeline;
+
 
 #pragma warning( pop )
 };
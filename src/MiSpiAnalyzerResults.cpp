@@ -1,7 +1,14 @@
 #include "MiSpiAnalyzerResults.h"
 #include <AnalyzerHelpers.h>
+#include <algorithm>
 #include "MiSpiAnalyzer.h"
 #include "MiSpiAnalyzerSettings.h"
+#include "MiSpiExportRange.h"
+#include "MiSpiCsvWriter.h"
+#include "MiSpiPacketDiffWriter.h"
+#include "MiSpiPacketStreamWriter.h"
+#include "MiSpiPcapngWriter.h"
+#include "MiSpiStatsWriter.h"
 #include <iostream>
 #include <sstream>
 #include <vector>
@@ -9,7 +16,7 @@
 #pragma warning( disable : 4996 ) // warning C4996: 'sprintf': This function or variable may be unsafe. Consider using sprintf_s instead.
 
 MiSpiAnalyzerResults::MiSpiAnalyzerResults( MiSpiAnalyzer* analyzer, MiSpiAnalyzerSettings* settings )
-    : AnalyzerResults(), mSettings( settings ), mAnalyzer( analyzer )
+    : AnalyzerResults(), mSettings( settings ), mAnalyzer( analyzer ), mRangeStart( 0 ), mRangeEnd( 0 )
 {
 }
 
@@ -38,66 +45,188 @@ void MiSpiAnalyzerResults::GenerateBubbleText( U64 frame_index, Channel& channel
         AddResultString( "Sync" );
     } else if (frame.mType == MiSpiData) {
         char number_str[128];
-        AnalyzerHelpers::GetNumberString( frame.mData1, display_base, 8, number_str, 128 );
+        AnalyzerHelpers::GetNumberString( frame.mData1, display_base, mSettings->mBitsPerWord, number_str, 128 );
         AddResultString( number_str );
     } else if (frame.mType == MiSpiError) {
         AddResultString( "Invalid" );
+    } else if (frame.mType == MiSpiRepeat) {
+        std::stringstream ss;
+        ss << "x" << frame.mData1 + frame.mData2;
+        AddResultString( "R" );
+        AddResultString( ss.str().c_str() );
+        ss.str( std::string() );
+        ss << "Repeat x" << frame.mData1 + frame.mData2;
+        AddResultString( ss.str().c_str() );
+        ss << " (" << frame.mData1 << " MOSI, " << frame.mData2 << " MISO)";
+        AddResultString( ss.str().c_str() );
     }
 }
 
-void MiSpiAnalyzerResults::GenerateExportFile( const char* file, DisplayBase display_base, U32 /*export_type_user_id*/ )
+void MiSpiAnalyzerResults::GenerateExportFile( const char* file, DisplayBase display_base, U32 export_type_user_id )
 {
-    // export_type_user_id is only important if we have more than one export type.
-
-    std::stringstream ss;
-    void* f = AnalyzerHelpers::StartFile( file );
-
-    ss << "Direction,Repetitions,";
-
-    if (mSettings->mShiftOrder == AnalyzerEnums::MsbFirst) {
-        ss << "Data (MSB First)";
-    } else {
-        ss << "Data (LSB First)";
+    if( export_type_user_id == 1 )
+    {
+        GenerateSearchFile( file );
+        return;
+    }
+    if( export_type_user_id == 3 )
+    {
+        GenerateTimingFile( file );
+        return;
     }
 
-    for (int i = 2; i < 27; i++) {
-        ss << "," << i;
+    // Compile the filter once, packets that don't match it are never formatted
+    mExportFilter.Compile( mSettings->mExportFilter.c_str() );
+
+    U64 sample_rate = mAnalyzer->GetSampleRate();
+    MiSpiCsvWriter csv( display_base, mSettings->mBitsPerWord, mSettings->mShiftOrder, sample_rate, mAnalyzer->GetTriggerSample(),
+                        ( MiSpiTimeUnit )mSettings->mExportTimestamps );
+    MiSpiCsvWriter filtered_csv( display_base, mSettings->mBitsPerWord, mSettings->mShiftOrder, sample_rate,
+                                 mAnalyzer->GetTriggerSample(), ( MiSpiTimeUnit )mSettings->mExportTimestamps );
+    MiSpiPcapngWriter pcapng( mSettings->mBitsPerWord, sample_rate );
+    MiSpiPacketStreamWriter stream( mSettings->mBitsPerWord, sample_rate );
+    MiSpiTimingHistogram timing[ MiSpiTimingMetricCount ];
+    GetTiming( timing );
+    MiSpiStatsWriter stats( sample_rate, timing );
+    MiSpiPacketDiffWriter diff( mSettings->mReferenceStream.c_str(), display_base, mSettings->mBitsPerWord, sample_rate );
+
+    // Every file is written from the same walk over the frames
+    std::vector<MiSpiExportWriter*> writers;
+    if( export_type_user_id == 0 )
+    {
+        csv.SetFilter( &mExportFilter );
+        csv.Open( file );
+        writers.push_back( &csv );
+    }
+    else if( export_type_user_id == 2 )
+    {
+        pcapng.SetFilter( &mExportFilter );
+        pcapng.Open( file );
+        writers.push_back( &pcapng );
+    }
+    else if( export_type_user_id == 4 )
+    {
+        stream.Open( file );
+        writers.push_back( &stream );
+    }
+    else if( export_type_user_id == 6 )
+    {
+        diff.Open( file );
+        writers.push_back( &diff );
+    }
+    else
+    {
+        // Named after the file that was asked for, without its extension
+        std::string base( file );
+        size_t dot = base.find_last_of( '.' );
+        if( dot != std::string::npos && base.find_first_of( "/\\", dot ) == std::string::npos )
+            base.erase( dot );
+
+        csv.Open( ( base + ".csv" ).c_str() );
+        writers.push_back( &csv );
+        if( !mExportFilter.IsEmpty() )
+        {
+            filtered_csv.SetFilter( &mExportFilter );
+            filtered_csv.Open( ( base + "-filtered.csv" ).c_str() );
+            writers.push_back( &filtered_csv );
+        }
+        pcapng.SetFilter( &mExportFilter );
+        pcapng.Open( ( base + ".pcapng" ).c_str() );
+        writers.push_back( &pcapng );
+        stream.Open( ( base + ".mispk" ).c_str() );
+        writers.push_back( &stream );
+        stats.Open( ( base + "-stats.csv" ).c_str() );
+        writers.push_back( &stats );
     }
-    ss << std::endl;
 
-    AnalyzerHelpers::AppendToFile( ( U8* )ss.str().c_str(), ss.str().length(), f );
-    ss.str( std::string() ); 
+    mWriters.swap( writers );
+    ExportFrames();
+    for( U32 i = 0; i < mWriters.size(); i++ )
+    {
+        mWriters[ i ]->Close();
+    }
+    mWriters.clear();
+}
 
+// Walk the frames once, putting packets back together and deduplicating them for all the writers
+void MiSpiAnalyzerResults::ExportFrames()
+{
     MiSpiDirection direction = MiSpiDirUnknown;
+    MiSpiDirection repeat_direction = MiSpiDirUnknown;
 
-    std::vector<U64> mosi_packet;
-    std::vector<U64> miso_packet;
-    std::vector<U64> new_packet;
-
-    U8 mosi_reps = 1;
-    U8 miso_reps = 1;
+    // Start from a clean deduplicator, a previous export may have been cancelled half way through
+    mosi_packet.resize(0);
+    miso_packet.resize(0);
+    new_packet.resize(0);
+    mosi_reps = 0;
+    miso_reps = 0;
+    mosi_start = mosi_end = 0;
+    miso_start = miso_end = 0;
+    new_start = new_end = 0;
+
+    // Only the frames around the range are walked, from the sync or error before it so the
+    // deduplicator starts from a clean state
+    MiSpiExportRange range;
+    range.Compile( mSettings->mExportRange.c_str() );
+    range.Resolve( mAnalyzer->GetSampleRate(), mAnalyzer->GetTriggerSample(), mRangeStart, mRangeEnd );
 
     U64 num_frames = GetNumFrames();
-    for( U32 i = 0; i < num_frames; i++ )
+    U64 first_frame = 0;
+    U64 progress_frames = num_frames;
+    if( !range.IsEmpty() && num_frames > 0 )
+    {
+        first_frame = FindResumeFrame( mRangeStart );
+        progress_frames = std::max( FindFrame( mRangeEnd ), first_frame ) + 1 - first_frame;
+    }
+
+    for( U64 i = first_frame; i < num_frames; i++ )
     {
         Frame frame = GetFrame( i );
+        // Past the range, but the data of a packet that started in it still belongs to it
+        if ( frame.mType != MiSpiData && ( U64 )frame.mStartingSampleInclusive > mRangeEnd ) {
+            break;
+        }
         // Switch on frame type,
         // if it's a direction frame, set the direction variable, and ...
         //    ... if we also already had a direction, commit packet to deduplicator for that direction
         if ( frame.mType == MiSpiStartMosi ) {
             if ( direction == MiSpiDirMiso )    {
-                SubmitMisoPacket(f, display_base);
+                SubmitMisoPacket();
             } else if (direction == MiSpiDirMosi ) {
-                SubmitMosiPacket(f, display_base);
+                SubmitMosiPacket();
             }
+            StartPacket(frame);
             direction = MiSpiDirMosi;
+            repeat_direction = MiSpiDirUnknown;
         } else if ( frame.mType == MiSpiStartMiso ) {
             if ( direction == MiSpiDirMosi ) {
-                SubmitMosiPacket(f, display_base);
+                SubmitMosiPacket();
             } else if (direction == MiSpiDirMiso) {
-                SubmitMisoPacket(f, display_base);
+                SubmitMisoPacket();
             }
+            StartPacket(frame);
             direction = MiSpiDirMiso;
+            repeat_direction = MiSpiDirUnknown;
+        } else if ( frame.mType == MiSpiRepeat ) {
+        // the decoder already folded repeats of the last packet in each direction, count them in
+            if ( direction == MiSpiDirMosi ) {
+                SubmitMosiPacket();
+            } else if ( direction == MiSpiDirMiso ) {
+                SubmitMisoPacket();
+            }
+            if ( frame.mData2 > 0 ) {
+                WriteRepeat(MiSpiDirMiso, miso_packet, frame.mData2, frame.mStartingSampleInclusive, frame.mEndingSampleInclusive);
+                miso_reps += frame.mData2;
+                miso_end = frame.mEndingSampleInclusive;
+            }
+            if ( frame.mData1 > 0 ) {
+                WriteRepeat(MiSpiDirMosi, mosi_packet, frame.mData1, frame.mStartingSampleInclusive, frame.mEndingSampleInclusive);
+                mosi_reps += frame.mData1;
+                mosi_end = frame.mEndingSampleInclusive;
+            }
+            // the last packet folded in is the one a following sync or error interrupts
+            repeat_direction = ( frame.mFlags & MISPI_REPEAT_ENDS_MOSI_FLAG ) ? MiSpiDirMosi : MiSpiDirMiso;
+            direction = MiSpiDirUnknown;
         } else if ( frame.mType == MiSpiData ) {
         // if it's a data frame, and we don't have a direction yet, discard it
         // if it's a data frame, and we DO have a direction, commit frame to packet
@@ -108,100 +237,217 @@ void MiSpiAnalyzerResults::GenerateExportFile( const char* file, DisplayBase dis
         } else {
             // and close whatever packet we were working on, if there was one
             if (direction == MiSpiDirMosi) {
-                SubmitMosiPacket(f, display_base);
-                CloseMosiPacket(f, display_base);
+                SubmitMosiPacket();
+                CloseMosiPacket();
             } else if (direction == MiSpiDirMiso) {
-                SubmitMisoPacket(f, display_base);
-                CloseMisoPacket(f, display_base);
+                SubmitMisoPacket();
+                CloseMisoPacket();
+            } else if (repeat_direction == MiSpiDirMosi) {
+                CloseMosiPacket();
+            } else if (repeat_direction == MiSpiDirMiso) {
+                CloseMisoPacket();
             }
-
-            //Record sync packets
-            if ( frame.mType == MiSpiSync) {
-                std::stringstream ss;
-                ss << "Sync" << std::endl;
-                AnalyzerHelpers::AppendToFile( ( U8* )ss.str().c_str(), ss.str().length(), f );
-                ss.str( std::string() );     
+            repeat_direction = MiSpiDirUnknown;
+
+            if ( ( U64 )frame.mEndingSampleInclusive >= mRangeStart ) {
+                for ( U32 w = 0; w < mWriters.size(); w++ ) {
+                    if ( frame.mType == MiSpiSync ) {
+                        mWriters[ w ]->WriteSync( frame.mStartingSampleInclusive, frame.mEndingSampleInclusive );
+                    } else {
+                        mWriters[ w ]->WriteError( frame.mStartingSampleInclusive, frame.mEndingSampleInclusive );
+                    }
+                }
             }
 
             direction = MiSpiDirUnknown;
         }
 
-        if( UpdateExportProgressAndCheckForCancel( i, num_frames ) == true )
+        if( UpdateExportProgressAndCheckForCancel( std::min( i - first_frame, progress_frames ), progress_frames ) == true )
+        {
+            ClosePackets(direction);
+            return;
+        }
+    }
+
+    // The last packet has nothing after it to complete it
+    if (direction == MiSpiDirMosi) {
+        SubmitMosiPacket();
+    } else if (direction == MiSpiDirMiso) {
+        SubmitMisoPacket();
+    }
+    ClosePackets(direction != MiSpiDirUnknown ? direction : repeat_direction);
+    UpdateExportProgressAndCheckForCancel( progress_frames, progress_frames );
+}
+
+void MiSpiAnalyzerResults::GenerateSearchFile( const char* file )
+{
+    void* f = AnalyzerHelpers::StartFile( file );
+
+    std::stringstream ss;
+    ss << "Direction,Start Sample,End Sample" << std::endl;
+
+    MiSpiDirection direction;
+    std::vector<U8> pattern;
+    std::string error;
+    if( MiSpiPacketIndex::ParsePattern( mSettings->mSearchPattern.c_str(), direction, pattern, error ) == false )
+    {
+        ss << error << std::endl;
+        AnalyzerHelpers::AppendToFile( ( U8* )ss.str().c_str(), ss.str().length(), f );
+        AnalyzerHelpers::EndFile( f );
+        return;
+    }
+
+    // Only the matches are walked, not the frames
+    std::vector<MiSpiPacketRange> matches;
+    FindPackets( direction, pattern, matches );
+
+    for( U64 i = 0; i < matches.size(); i++ )
+    {
+        ss << ( matches[ i ].mDirection == MiSpiDirMosi ? "MOSI," : "MISO," ) << matches[ i ].mStartingSampleInclusive << ","
+           << matches[ i ].mEndingSampleInclusive << std::endl;
+
+        AnalyzerHelpers::AppendToFile( ( U8* )ss.str().c_str(), ss.str().length(), f );
+        ss.str( std::string() );
+
+        if( UpdateExportProgressAndCheckForCancel( i, matches.size() ) == true )
         {
-            ClosePackets(f, display_base, direction);
             AnalyzerHelpers::EndFile( f );
             return;
         }
     }
 
-    ClosePackets(f, display_base, direction);
-    UpdateExportProgressAndCheckForCancel( num_frames, num_frames );
+    AnalyzerHelpers::AppendToFile( ( U8* )ss.str().c_str(), ss.str().length(), f );
+    UpdateExportProgressAndCheckForCancel( matches.size(), matches.size() );
     AnalyzerHelpers::EndFile( f );
 }
 
+void MiSpiAnalyzerResults::GenerateTimingFile( const char* file )
+{
+    void* f = AnalyzerHelpers::StartFile( file );
+
+    MiSpiTimingHistogram timing[ MiSpiTimingMetricCount ];
+    GetTiming( timing );
+
+    std::stringstream ss;
+    MiSpiStatsWriter::AppendTiming( ss, timing, mAnalyzer->GetSampleRate() );
+
+    AnalyzerHelpers::AppendToFile( ( U8* )ss.str().c_str(), ss.str().length(), f );
+    UpdateExportProgressAndCheckForCancel( 1, 1 );
+    AnalyzerHelpers::EndFile( f );
+}
+
+void MiSpiAnalyzerResults::AddTiming( const MiSpiTimingHistogram* timing )
+{
+    std::lock_guard<std::mutex> lock( mTimingMutex );
+    for( int i = 0; i < MiSpiTimingMetricCount; i++ )
+    {
+        mTiming[ i ].Merge( timing[ i ] );
+    }
+}
+
+void MiSpiAnalyzerResults::GetTiming( MiSpiTimingHistogram* timing )
+{
+    std::lock_guard<std::mutex> lock( mTimingMutex );
+    for( int i = 0; i < MiSpiTimingMetricCount; i++ )
+    {
+        timing[ i ] = mTiming[ i ];
+    }
+}
+
+// Last frame starting at or before sample, or the first frame if there's none
+U64 MiSpiAnalyzerResults::FindFrame( U64 sample )
+{
+    U64 low = 0;
+    U64 high = GetNumFrames();
+    while( high - low > 1 )
+    {
+        U64 middle = low + ( high - low ) / 2;
+        if( ( U64 )GetFrame( middle ).mStartingSampleInclusive <= sample )
+            low = middle;
+        else
+            high = middle;
+    }
+    return low;
+}
+
+// The sync or error frame the deduplicator has to start from to export what comes after sample
+U64 MiSpiAnalyzerResults::FindResumeFrame( U64 sample )
+{
+    U64 index = FindFrame( sample );
+    while( index > 0 )
+    {
+        Frame frame = GetFrame( index );
+        if( frame.mType == MiSpiSync || frame.mType == MiSpiError )
+            break;
+        index--;
+    }
+    return index;
+}
+
+void MiSpiAnalyzerResults::AddIndexedPacket( MiSpiDirection direction, const std::vector<U8>& payload, U64 start_sample,
+                                             U64 end_sample, bool repeat )
+{
+    mPacketIndex.AddPacket( direction, payload, start_sample, end_sample, repeat );
+}
+
+void MiSpiAnalyzerResults::FindPackets( MiSpiDirection direction, const std::vector<U8>& pattern, std::vector<MiSpiPacketRange>& matches )
+{
+    mPacketIndex.Find( direction, pattern, matches );
+}
+
+void MiSpiAnalyzerResults::StartPacket(Frame frame) {
+    new_start = frame.mStartingSampleInclusive;
+    new_end = frame.mEndingSampleInclusive;
+}
+
 void MiSpiAnalyzerResults::SubmitFrame(Frame frame) {
     new_packet.push_back(frame.mData1);
+    new_end = frame.mEndingSampleInclusive;
 }
 
-void MiSpiAnalyzerResults::CloseMisoPacket(void *f, DisplayBase display_base) {
-    // Print the direction, rep count, packet
-    std::stringstream ss; 
-    char rep_str[ 128 ] = "";
-    AnalyzerHelpers::GetNumberString( miso_reps, DisplayBase::Decimal, 8, rep_str, 128 );
-    ss << "MISO," << rep_str;
-    for (int i = 0; i < miso_packet.size(); i++) {
-        char data_str[ 128 ] = "";
-        AnalyzerHelpers::GetNumberString( miso_packet[i], display_base, 8, data_str, 128 );
-        ss << "," << data_str;
-    }
-    ss << std::endl;
-    AnalyzerHelpers::AppendToFile( ( U8* )ss.str().c_str(), ss.str().length(), f );
-    ss.str( std::string() ); 
-
+void MiSpiAnalyzerResults::CloseMisoPacket() {
+    // Nothing to write if it was closed already, or nothing went this way
+    if (miso_reps > 0) {
+        WriteLine(MiSpiDirMiso, miso_packet, miso_reps, miso_start, miso_end);
+    }
     miso_packet.resize(0);
+    miso_reps = 0;
 }
 
-void MiSpiAnalyzerResults::CloseMosiPacket(void *f, DisplayBase display_base) {
-    // Print the direction, rep count, packet
-    std::stringstream ss; 
-    char rep_str[ 128 ] = "";
-    AnalyzerHelpers::GetNumberString( mosi_reps, DisplayBase::Decimal, 8, rep_str, 128 );
-    ss << "MOSI," << rep_str;
-    for (int i = 0; i < mosi_packet.size(); i++) {
-        char data_str[ 128 ] = "";
-        AnalyzerHelpers::GetNumberString( mosi_packet[i], display_base, 8, data_str, 128 );
-        ss << "," << data_str;
-    }
-    ss << std::endl;
-    AnalyzerHelpers::AppendToFile( ( U8* )ss.str().c_str(), ss.str().length(), f );
-    ss.str( std::string() ); 
-
+void MiSpiAnalyzerResults::CloseMosiPacket() {
+    // Nothing to write if it was closed already, or nothing went this way
+    if (mosi_reps > 0) {
+        WriteLine(MiSpiDirMosi, mosi_packet, mosi_reps, mosi_start, mosi_end);
+    }
     mosi_packet.resize(0);
+    mosi_reps = 0;
 }
 
 // Print the last packets of the capture
-void MiSpiAnalyzerResults::ClosePackets(void *f, DisplayBase display_base, int direction) {
+void MiSpiAnalyzerResults::ClosePackets(int direction) {
     // Print them in the order we received them
     if (direction == MiSpiDirMosi) {
-        CloseMosiPacket(f, display_base);
-        CloseMisoPacket(f, display_base);
+        CloseMosiPacket();
+        CloseMisoPacket();
     } else {
-        CloseMisoPacket(f, display_base);
-        CloseMosiPacket(f, display_base);
+        CloseMisoPacket();
+        CloseMosiPacket();
     }
 }
 
-void MiSpiAnalyzerResults::SubmitMisoPacket(void *f, DisplayBase display_base) {
-    if (new_packet == miso_packet) {
+void MiSpiAnalyzerResults::SubmitMisoPacket() {
+    WritePacket(MiSpiDirMiso, new_packet, new_start, new_end);
+    if (miso_reps > 0 && new_packet == miso_packet) {
         // Nothing new here
         miso_reps++;
+        miso_end = new_end;
     } else {
-        if (miso_packet.size() > 0) {
-            CloseMisoPacket(f, display_base);
-        }
+        CloseMisoPacket();
         // The new packet becomes the reference
         miso_packet.resize(new_packet.size());
         miso_reps = 1;
+        miso_start = new_start;
+        miso_end = new_end;
         for (int i = 0; i < new_packet.size(); i++) {
             miso_packet[i] = new_packet[i];
         }
@@ -209,17 +455,19 @@ void MiSpiAnalyzerResults::SubmitMisoPacket(void *f, DisplayBase display_base) {
     new_packet.resize(0);
 }
 
-void MiSpiAnalyzerResults::SubmitMosiPacket(void *f, DisplayBase display_base) {
-    if (new_packet == mosi_packet) {
+void MiSpiAnalyzerResults::SubmitMosiPacket() {
+    WritePacket(MiSpiDirMosi, new_packet, new_start, new_end);
+    if (mosi_reps > 0 && new_packet == mosi_packet) {
         // Nothing new here
         mosi_reps++;
+        mosi_end = new_end;
     } else {
-        if (mosi_packet.size() > 0) {
-            CloseMosiPacket(f, display_base);
-        }
+        CloseMosiPacket();
         // The new packet becomes the reference
         mosi_packet.resize(new_packet.size());
         mosi_reps = 1;
+        mosi_start = new_start;
+        mosi_end = new_end;
         for (int i = 0; i < new_packet.size(); i++) {
             mosi_packet[i] = new_packet[i];
         }
@@ -227,6 +475,40 @@ void MiSpiAnalyzerResults::SubmitMosiPacket(void *f, DisplayBase display_base) {
     new_packet.resize(0);
 }
 
+// Hand a packet to every writer whose filter it matches, unless it ended before the export range
+void MiSpiAnalyzerResults::WritePacket(MiSpiDirection direction, const std::vector<U64>& packet, U64 start, U64 end) {
+    if (end < mRangeStart) {
+        return;
+    }
+    for (U32 w = 0; w < mWriters.size(); w++) {
+        if (mWriters[ w ]->Matches(direction, packet, start, end)) {
+            mWriters[ w ]->WritePacket(direction, packet, start, end);
+        }
+    }
+}
+
+void MiSpiAnalyzerResults::WriteRepeat(MiSpiDirection direction, const std::vector<U64>& packet, U64 count, U64 start, U64 end) {
+    if (end < mRangeStart) {
+        return;
+    }
+    for (U32 w = 0; w < mWriters.size(); w++) {
+        if (mWriters[ w ]->Matches(direction, packet, start, end)) {
+            mWriters[ w ]->WriteRepeat(direction, packet, count, start, end);
+        }
+    }
+}
+
+void MiSpiAnalyzerResults::WriteLine(MiSpiDirection direction, const std::vector<U64>& packet, U64 reps, U64 start, U64 end) {
+    if (end < mRangeStart) {
+        return;
+    }
+    for (U32 w = 0; w < mWriters.size(); w++) {
+        if (mWriters[ w ]->Matches(direction, packet, start, end)) {
+            mWriters[ w ]->WriteLine(direction, packet, reps, start, end);
+        }
+    }
+}
+
 void MiSpiAnalyzerResults::GenerateFrameTabularText( U64 frame_index, DisplayBase display_base )
 {
     ClearTabularText();
@@ -236,9 +518,13 @@ void MiSpiAnalyzerResults::GenerateFrameTabularText( U64 frame_index, DisplayBas
 
     std::stringstream ss;
 
-    if( ( frame.mFlags & SPI_ERROR_FLAG ) == 0 )
+    if( frame.mType == MiSpiRepeat )
+    {
+        ss << "REPEAT: " << frame.mData1 << " MOSI, " << frame.mData2 << " MISO";
+    }
+    else if( ( frame.mFlags & SPI_ERROR_FLAG ) == 0 )
     {
-        AnalyzerHelpers::GetNumberString( frame.mData1, display_base, 8, data_str, 128 );
+        AnalyzerHelpers::GetNumberString( frame.mData1, display_base, mSettings->mBitsPerWord, data_str, 128 );
 
         ss << "DATA: " << data_str;
     }
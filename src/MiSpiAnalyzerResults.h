@@ -2,15 +2,24 @@
 #define SPI_ANALYZER_RESULTS
 
 #include <AnalyzerResults.h>
+#include <vector>
+#include "MiSpiTypes.h"
+#include "MiSpiPacketFilter.h"
+#include "MiSpiPacketIndex.h"
+#include "MiSpiTimingHistogram.h"
+#include "MiSpiExportWriter.h"
+#include <mutex>
 
 #define SPI_ERROR_FLAG ( 1 << 0 )
+#define MISPI_REPEAT_ENDS_MOSI_FLAG ( 1 << 1 )
 
 enum MiSpiFrameType {
   MiSpiStartMiso,
   MiSpiStartMosi,
   MiSpiData,
   MiSpiError,
-  MiSpiSync
+  MiSpiSync,
+  MiSpiRepeat
 };
 
 class MiSpiAnalyzer;
@@ -29,21 +38,44 @@ class MiSpiAnalyzerResults : public AnalyzerResults
     virtual void GeneratePacketTabularText( U64 packet_id, DisplayBase display_base );
     virtual void GenerateTransactionTabularText( U64 transaction_id, DisplayBase display_base );
 
+    void AddIndexedPacket( MiSpiDirection direction, const std::vector<U8>& payload, U64 start_sample, U64 end_sample, bool repeat );
+    void FindPackets( MiSpiDirection direction, const std::vector<U8>& pattern, std::vector<MiSpiPacketRange>& matches );
+    void AddTiming( const MiSpiTimingHistogram* timing );
+    void GetTiming( MiSpiTimingHistogram* timing );
+
   protected: // functions
+    void GenerateSearchFile( const char* file );
+    void GenerateTimingFile( const char* file );
+    void ExportFrames();
+    U64 FindFrame( U64 sample );
+    U64 FindResumeFrame( U64 sample );
+    void StartPacket(Frame frame);
     void SubmitFrame(Frame frame);
-    void SubmitMisoPacket(void *f, DisplayBase display_base);
-    void SubmitMosiPacket(void *f, DisplayBase display_base);
-    void ClosePackets(void *f, DisplayBase display_base, int direction);
-    void CloseMisoPacket(void *f, DisplayBase display_base);
-    void CloseMosiPacket(void *f, DisplayBase display_base);
+    void SubmitMisoPacket();
+    void SubmitMosiPacket();
+    void ClosePackets(int direction);
+    void CloseMisoPacket();
+    void CloseMosiPacket();
+    void WritePacket(MiSpiDirection direction, const std::vector<U64>& packet, U64 start, U64 end);
+    void WriteRepeat(MiSpiDirection direction, const std::vector<U64>& packet, U64 count, U64 start, U64 end);
+    void WriteLine(MiSpiDirection direction, const std::vector<U64>& packet, U64 reps, U64 start, U64 end);
   protected: // vars
     MiSpiAnalyzerSettings* mSettings;
     MiSpiAnalyzer* mAnalyzer;
     std::vector<U64> mosi_packet;
     std::vector<U64> miso_packet;
     std::vector<U64> new_packet;
-    U8 mosi_reps;
-    U8 miso_reps;
+    U64 mosi_reps;
+    U64 miso_reps;
+    U64 mosi_start, mosi_end;
+    U64 miso_start, miso_end;
+    U64 new_start, new_end;
+    MiSpiPacketFilter mExportFilter;
+    U64 mRangeStart, mRangeEnd;
+    std::vector<MiSpiExportWriter*> mWriters;
+    MiSpiPacketIndex mPacketIndex;
+    MiSpiTimingHistogram mTiming[ MiSpiTimingMetricCount ];
+    std::mutex mTimingMutex;
 };
 
 #endif // SPI_ANALYZER_RESULTS
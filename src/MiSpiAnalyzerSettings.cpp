@@ -1,4 +1,8 @@
 #include "MiSpiAnalyzerSettings.h"
+#include "MiSpiExportRange.h"
+#include "MiSpiPacketFilter.h"
+#include "MiSpiPacketIndex.h"
+#include "MiSpiTimeBase.h"
 
 #include <AnalyzerHelpers.h>
 #include <sstream>
@@ -7,7 +11,10 @@
 MiSpiAnalyzerSettings::MiSpiAnalyzerSettings()
     : mDataChannel( UNDEFINED_CHANNEL ),
       mClockChannel( UNDEFINED_CHANNEL ),
-      mShiftOrder( AnalyzerEnums::MsbFirst )
+      mShiftOrder( AnalyzerEnums::MsbFirst ),
+      mBitsPerWord( 8 ),
+      mCollapseRepeats( false ),
+      mExportTimestamps( MiSpiTimeNone )
 {
     mDataChannelInterface.reset( new AnalyzerSettingInterfaceChannel() );
     mDataChannelInterface->SetTitleAndTooltip( "Data", "MOSI/MISO (Multiplexed)" );
@@ -25,13 +32,91 @@ MiSpiAnalyzerSettings::MiSpiAnalyzerSettings()
     mShiftOrderInterface->AddNumber( AnalyzerEnums::LsbFirst, "LSB First", "" );
     mShiftOrderInterface->SetNumber( mShiftOrder );
 
+    mBitsPerWordInterface.reset( new AnalyzerSettingInterfaceNumberList() );
+    mBitsPerWordInterface->SetTitleAndTooltip( "Bits per Word", "" );
+    mBitsPerWordInterface->AddNumber( 8, "8 Bits per Word (Standard)", "" );
+    mBitsPerWordInterface->AddNumber( 16, "16 Bits per Word", "" );
+    mBitsPerWordInterface->AddNumber( 32, "32 Bits per Word", "" );
+    mBitsPerWordInterface->SetNumber( mBitsPerWord );
+
+    mCollapseRepeatsInterface.reset( new AnalyzerSettingInterfaceBool() );
+    mCollapseRepeatsInterface->SetTitleAndTooltip( "Repeats",
+                                                   "Fold packets that repeat the last packet in the same direction into a single "
+                                                   "Repeat frame instead of decoding every word of every repeat." );
+    mCollapseRepeatsInterface->SetCheckBoxText( "Collapse repeated packets" );
+    mCollapseRepeatsInterface->SetValue( mCollapseRepeats );
+
+    mExportFilterInterface.reset( new AnalyzerSettingInterfaceText() );
+    mExportFilterInterface->SetTitleAndTooltip( "Export Filter",
+                                                "Only export matching packets, e.g. \"mosi word[0]=A5 len>=3, miso len=0\". "
+                                                "Terms: dir=mosi|miso, len<op>N, word[N]=HH[/MASK], sample=A-B. "
+                                                "Spaces AND terms, commas OR groups. Leave empty to export everything." );
+    mExportFilterInterface->SetText( mExportFilter.c_str() );
+
+    mSearchPatternInterface.reset( new AnalyzerSettingInterfaceText() );
+    mSearchPatternInterface->SetTitleAndTooltip( "Search Pattern",
+                                                 "Hex bytes to look for with \"Export pattern search matches\", "
+                                                 "optionally prefixed with a direction, e.g. \"mosi A5 01\"." );
+    mSearchPatternInterface->SetText( mSearchPattern.c_str() );
+
+    mExportTimestampsInterface.reset( new AnalyzerSettingInterfaceNumberList() );
+    mExportTimestampsInterface->SetTitleAndTooltip( "Export Timestamps",
+                                                    "Add packet start and end time columns to the CSV export, relative to the trigger" );
+    mExportTimestampsInterface->AddNumber( MiSpiTimeNone, "No Timestamps", "" );
+    mExportTimestampsInterface->AddNumber( MiSpiTimeSeconds, "Seconds", "" );
+    mExportTimestampsInterface->AddNumber( MiSpiTimeMilliseconds, "Milliseconds", "" );
+    mExportTimestampsInterface->AddNumber( MiSpiTimeMicroseconds, "Microseconds", "" );
+    mExportTimestampsInterface->AddNumber( MiSpiTimeNanoseconds, "Nanoseconds", "" );
+    mExportTimestampsInterface->SetNumber( mExportTimestamps );
+
+    mExportRangeInterface.reset( new AnalyzerSettingInterfaceText() );
+    mExportRangeInterface->SetTitleAndTooltip( "Export Range",
+                                               "Only export packets in this range with the CSV export, either sample numbers "
+                                               "\"A-B\" or times relative to the trigger, e.g. \"-2.5ms-10ms\" (s, ms, us or ns). "
+                                               "Leave empty to export the whole capture." );
+    mExportRangeInterface->SetText( mExportRange.c_str() );
+
+    mReferenceStreamInterface.reset( new AnalyzerSettingInterfaceText() );
+    mReferenceStreamInterface->SetTitleAndTooltip( "Reference Stream",
+                                                   "Packet stream (.mispk) exported from another capture, for \"Export comparison "
+                                                   "with the reference stream\" to compare this capture with." );
+    mReferenceStreamInterface->SetTextType( AnalyzerSettingInterfaceText::FilePath );
+    mReferenceStreamInterface->SetText( mReferenceStream.c_str() );
+
+    mDecodeCacheFolderInterface.reset( new AnalyzerSettingInterfaceText() );
+    mDecodeCacheFolderInterface->SetTitleAndTooltip( "Decode Cache",
+                                                     "Folder to keep decoded results in, so a capture that's opened again with "
+                                                     "the same settings is played back instead of decoded. Leave empty to always decode." );
+    mDecodeCacheFolderInterface->SetTextType( AnalyzerSettingInterfaceText::FolderPath );
+    mDecodeCacheFolderInterface->SetText( mDecodeCacheFolder.c_str() );
+
     AddInterface( mDataChannelInterface.get() );
     AddInterface( mClockChannelInterface.get() );
     AddInterface( mShiftOrderInterface.get() );
+    AddInterface( mBitsPerWordInterface.get() );
+    AddInterface( mCollapseRepeatsInterface.get() );
+    AddInterface( mExportFilterInterface.get() );
+    AddInterface( mSearchPatternInterface.get() );
+    AddInterface( mExportTimestampsInterface.get() );
+    AddInterface( mExportRangeInterface.get() );
+    AddInterface( mReferenceStreamInterface.get() );
+    AddInterface( mDecodeCacheFolderInterface.get() );
 
     // AddExportOption( 0, "Export as text/csv file", "text (*.txt);;csv (*.csv)" );
     AddExportOption( 0, "Export as CSV file" );
     AddExportExtension( 0, "csv", "csv" );
+    AddExportOption( 1, "Export pattern search matches" );
+    AddExportExtension( 1, "csv", "csv" );
+    AddExportOption( 2, "Export as pcapng file" );
+    AddExportExtension( 2, "pcapng", "pcapng" );
+    AddExportOption( 3, "Export timing statistics" );
+    AddExportExtension( 3, "csv", "csv" );
+    AddExportOption( 4, "Export as packet stream" );
+    AddExportExtension( 4, "mispk", "mispk" );
+    AddExportOption( 5, "Export CSV, pcapng, packet stream and statistics in one pass" );
+    AddExportExtension( 5, "csv", "csv" );
+    AddExportOption( 6, "Export comparison with the reference stream" );
+    AddExportExtension( 6, "csv", "csv" );
 
     ClearChannels();
     AddChannel( mDataChannel, "DATA", false );
@@ -57,10 +142,45 @@ bool MiSpiAnalyzerSettings::SetSettingsFromInterfaces()
         return false;
     }
 
+    MiSpiPacketFilter filter;
+    if( filter.Compile( mExportFilterInterface->GetText() ) == false )
+    {
+        SetErrorText( filter.GetError() );
+        return false;
+    }
+
+    MiSpiExportRange range;
+    if( range.Compile( mExportRangeInterface->GetText() ) == false )
+    {
+        SetErrorText( range.GetError() );
+        return false;
+    }
+
+    const char* search_pattern = mSearchPatternInterface->GetText();
+    if( search_pattern != NULL && search_pattern[ 0 ] != '\0' )
+    {
+        MiSpiDirection direction;
+        std::vector<U8> pattern;
+        std::string error;
+        if( MiSpiPacketIndex::ParsePattern( search_pattern, direction, pattern, error ) == false )
+        {
+            SetErrorText( error.c_str() );
+            return false;
+        }
+    }
+
     mDataChannel = mDataChannelInterface->GetChannel();
     mClockChannel = mClockChannelInterface->GetChannel();
 
     mShiftOrder = ( AnalyzerEnums::ShiftOrder )U32( mShiftOrderInterface->GetNumber() );
+    mExportFilter = mExportFilterInterface->GetText();
+    mSearchPattern = mSearchPatternInterface->GetText();
+    mCollapseRepeats = mCollapseRepeatsInterface->GetValue();
+    mBitsPerWord = U32( mBitsPerWordInterface->GetNumber() );
+    mDecodeCacheFolder = mDecodeCacheFolderInterface->GetText();
+    mExportTimestamps = U32( mExportTimestampsInterface->GetNumber() );
+    mExportRange = mExportRangeInterface->GetText();
+    mReferenceStream = mReferenceStreamInterface->GetText();
 
     ClearChannels();
     AddChannel( mDataChannel, "DATA", mDataChannel != UNDEFINED_CHANNEL );
@@ -83,6 +203,33 @@ void MiSpiAnalyzerSettings::LoadSettings( const char* settings )
     text_archive >> mClockChannel;
     text_archive >> *( U32* )&mShiftOrder;
 
+    // Settings saved by older versions end here
+    const char* export_filter;
+    if( text_archive >> &export_filter )
+        mExportFilter = export_filter;
+    const char* search_pattern;
+    if( text_archive >> &search_pattern )
+        mSearchPattern = search_pattern;
+    bool collapse_repeats;
+    if( text_archive >> collapse_repeats )
+        mCollapseRepeats = collapse_repeats;
+    // Only the widths offered in the list, a damaged settings string keeps the default
+    U32 bits_per_word;
+    if( text_archive >> bits_per_word && ( bits_per_word == 8 || bits_per_word == 16 || bits_per_word == 32 ) )
+        mBitsPerWord = bits_per_word;
+    const char* decode_cache_folder;
+    if( text_archive >> &decode_cache_folder )
+        mDecodeCacheFolder = decode_cache_folder;
+    U32 export_timestamps;
+    if( text_archive >> export_timestamps )
+        mExportTimestamps = export_timestamps;
+    const char* export_range;
+    if( text_archive >> &export_range )
+        mExportRange = export_range;
+    const char* reference_stream;
+    if( text_archive >> &reference_stream )
+        mReferenceStream = reference_stream;
+
     ClearChannels();
     AddChannel( mDataChannel, "DATA", mDataChannel != UNDEFINED_CHANNEL );
     AddChannel( mClockChannel, "CLOCK", mClockChannel != UNDEFINED_CHANNEL );
@@ -98,6 +245,14 @@ const char* MiSpiAnalyzerSettings::SaveSettings()
     text_archive << mDataChannel;
     text_archive << mClockChannel;
     text_archive << mShiftOrder;
+    text_archive << mExportFilter.c_str();
+    text_archive << mSearchPattern.c_str();
+    text_archive << mCollapseRepeats;
+    text_archive << mBitsPerWord;
+    text_archive << mDecodeCacheFolder.c_str();
+    text_archive << mExportTimestamps;
+    text_archive << mExportRange.c_str();
+    text_archive << mReferenceStream.c_str();
 
     return SetReturnString( text_archive.GetString() );
 }
@@ -107,4 +262,12 @@ void MiSpiAnalyzerSettings::UpdateInterfacesFromSettings()
     mDataChannelInterface->SetChannel( mDataChannel );
     mClockChannelInterface->SetChannel( mClockChannel );
     mShiftOrderInterface->SetNumber( mShiftOrder );
+    mExportFilterInterface->SetText( mExportFilter.c_str() );
+    mSearchPatternInterface->SetText( mSearchPattern.c_str() );
+    mCollapseRepeatsInterface->SetValue( mCollapseRepeats );
+    mBitsPerWordInterface->SetNumber( mBitsPerWord );
+    mDecodeCacheFolderInterface->SetText( mDecodeCacheFolder.c_str() );
+    mExportTimestampsInterface->SetNumber( mExportTimestamps );
+    mExportRangeInterface->SetText( mExportRange.c_str() );
+    mReferenceStreamInterface->SetText( mReferenceStream.c_str() );
 }
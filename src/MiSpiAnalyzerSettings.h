@@ -3,6 +3,7 @@
 
 #include <AnalyzerSettings.h>
 #include <AnalyzerTypes.h>
+#include <string>
 
 class MiSpiAnalyzerSettings : public AnalyzerSettings
 {
@@ -21,6 +22,14 @@ class MiSpiAnalyzerSettings : public AnalyzerSettings
     Channel mDataChannel;
     Channel mClockChannel;
     AnalyzerEnums::ShiftOrder mShiftOrder;
+    U32 mBitsPerWord;
+    std::string mExportFilter;
+    std::string mSearchPattern;
+    bool mCollapseRepeats;
+    std::string mDecodeCacheFolder;
+    U32 mExportTimestamps;
+    std::string mExportRange;
+    std::string mReferenceStream;
 
 
   protected:
@@ -29,6 +38,14 @@ class MiSpiAnalyzerSettings : public AnalyzerSettings
     std::auto_ptr<AnalyzerSettingInterfaceChannel> mDataChannelInterface;
     std::auto_ptr<AnalyzerSettingInterfaceChannel> mClockChannelInterface;
     std::auto_ptr<AnalyzerSettingInterfaceNumberList> mShiftOrderInterface;
+    std::auto_ptr<AnalyzerSettingInterfaceNumberList> mBitsPerWordInterface;
+    std::auto_ptr<AnalyzerSettingInterfaceText> mExportFilterInterface;
+    std::auto_ptr<AnalyzerSettingInterfaceText> mSearchPatternInterface;
+    std::auto_ptr<AnalyzerSettingInterfaceBool> mCollapseRepeatsInterface;
+    std::auto_ptr<AnalyzerSettingInterfaceText> mDecodeCacheFolderInterface;
+    std::auto_ptr<AnalyzerSettingInterfaceNumberList> mExportTimestampsInterface;
+    std::auto_ptr<AnalyzerSettingInterfaceText> mExportRangeInterface;
+    std::auto_ptr<AnalyzerSettingInterfaceText> mReferenceStreamInterface;
 };
 
 #endif // SPI_ANALYZER_SETTINGS
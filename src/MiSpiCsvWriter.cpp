@@ -0,0 +1,96 @@
+#include "MiSpiCsvWriter.h"
+
+#include <AnalyzerHelpers.h>
+
+MiSpiCsvWriter::MiSpiCsvWriter( DisplayBase display_base, U32 bits_per_word, AnalyzerEnums::ShiftOrder shift_order, U64 sample_rate,
+                                U64 trigger_sample, MiSpiTimeUnit time_unit )
+    : mDisplayBase( display_base ), mBitsPerWord( bits_per_word ), mShiftOrder( shift_order )
+{
+    // Times are worked out from sample numbers with a scale computed once here, relative to the trigger
+    mTimeBase.Init( sample_rate, trigger_sample, time_unit );
+}
+
+MiSpiCsvWriter::~MiSpiCsvWriter()
+{
+}
+
+void MiSpiCsvWriter::Open( const char* file )
+{
+    MiSpiExportWriter::Open( file );
+
+    std::stringstream ss;
+    ss << "Direction,Repetitions,";
+    if( mTimeBase.IsEnabled() )
+    {
+        ss << "Start (" << mTimeBase.GetUnitName() << "),End (" << mTimeBase.GetUnitName() << "),";
+    }
+
+    if( mShiftOrder == AnalyzerEnums::MsbFirst )
+    {
+        ss << "Data (MSB First)";
+    }
+    else
+    {
+        ss << "Data (LSB First)";
+    }
+
+    for( int i = 2; i < 27; i++ )
+    {
+        ss << "," << i;
+    }
+    ss << std::endl;
+
+    Append( ss.str() );
+}
+
+// Print the direction, rep count, packet
+void MiSpiCsvWriter::WriteLine( MiSpiDirection direction, const std::vector<U64>& packet, U64 repeats, U64 start_sample, U64 end_sample )
+{
+    std::stringstream ss;
+    char rep_str[ 128 ] = "";
+    AnalyzerHelpers::GetNumberString( repeats, DisplayBase::Decimal, 64, rep_str, 128 );
+    ss << ( direction == MiSpiDirMosi ? "MOSI," : "MISO," ) << rep_str;
+    if( mTimeBase.IsEnabled() )
+    {
+        AppendTimes( ss, start_sample, end_sample );
+    }
+    for( U64 i = 0; i < packet.size(); i++ )
+    {
+        char data_str[ 128 ] = "";
+        AnalyzerHelpers::GetNumberString( packet[ i ], mDisplayBase, mBitsPerWord, data_str, 128 );
+        ss << "," << data_str;
+    }
+    ss << std::endl;
+
+    Append( ss.str() );
+    FlushIfFull();
+}
+
+// Record sync packets, unless we're only after specific packets
+void MiSpiCsvWriter::WriteSync( U64 start_sample, U64 end_sample )
+{
+    if( mFilter != NULL && !mFilter->IsEmpty() )
+        return;
+
+    std::stringstream ss;
+    ss << "Sync";
+    if( mTimeBase.IsEnabled() )
+    {
+        ss << ",";
+        AppendTimes( ss, start_sample, end_sample );
+    }
+    ss << std::endl;
+
+    Append( ss.str() );
+    FlushIfFull();
+}
+
+// ",start,end" in the export's time unit
+void MiSpiCsvWriter::AppendTimes( std::stringstream& ss, U64 start_sample, U64 end_sample )
+{
+    char time_str[ 32 ];
+    mTimeBase.Format( start_sample, time_str );
+    ss << "," << time_str;
+    mTimeBase.Format( end_sample, time_str );
+    ss << "," << time_str;
+}
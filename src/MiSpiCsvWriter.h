@@ -0,0 +1,31 @@
+#ifndef MISPI_CSV_WRITER
+#define MISPI_CSV_WRITER
+
+#include <AnalyzerTypes.h>
+#include "MiSpiExportWriter.h"
+#include "MiSpiTimeBase.h"
+#include <sstream>
+
+// The CSV export, a line per run of identical packets in a direction with its repetition count,
+// and a line per sync unless a filter is set.
+class MiSpiCsvWriter : public MiSpiExportWriter
+{
+  public:
+    MiSpiCsvWriter( DisplayBase display_base, U32 bits_per_word, AnalyzerEnums::ShiftOrder shift_order, U64 sample_rate,
+                    U64 trigger_sample, MiSpiTimeUnit time_unit );
+    virtual ~MiSpiCsvWriter();
+
+    virtual void Open( const char* file );
+    virtual void WriteLine( MiSpiDirection direction, const std::vector<U64>& packet, U64 repeats, U64 start_sample, U64 end_sample );
+    virtual void WriteSync( U64 start_sample, U64 end_sample );
+
+  protected:
+    void AppendTimes( std::stringstream& ss, U64 start_sample, U64 end_sample );
+
+    DisplayBase mDisplayBase;
+    U32 mBitsPerWord;
+    AnalyzerEnums::ShiftOrder mShiftOrder;
+    MiSpiTimeBase mTimeBase;
+};
+
+#endif // MISPI_CSV_WRITER
@@ -0,0 +1,606 @@
+#include "MiSpiDecodeCache.h"
+#include "MiSpiVarint.h"
+
+#include <AnalyzerHelpers.h>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+#define MISPI_CACHE_MAGIC "MISPIDC2"
+#define MISPI_CACHE_BUFFER_SIZE ( 1024 * 1024 )
+
+// Longest record the reader looks for the end of before taking the file as damaged
+#define MISPI_CACHE_RECORD_LIMIT ( 16 * 1024 * 1024 )
+
+// 64 bit FNV-1a
+#define MISPI_FNV_OFFSET 0xCBF29CE484222325ULL
+#define MISPI_FNV_PRIME 0x100000001B3ULL
+
+static bool SameWords( const std::vector<MiSpiWord>& a, const std::vector<MiSpiWord>& b )
+{
+    if( a.size() != b.size() )
+        return false;
+    for( size_t i = 0; i < a.size(); i++ )
+    {
+        if( a[ i ].mData != b[ i ].mData || a[ i ].mStartingSampleInclusive != b[ i ].mStartingSampleInclusive ||
+            a[ i ].mEndingSampleInclusive != b[ i ].mEndingSampleInclusive )
+            return false;
+    }
+    return true;
+}
+
+static bool SameCheckpoint( const MiSpiDecodeCheckpoint& a, const MiSpiDecodeCheckpoint& b )
+{
+    return a.mSample == b.mSample && a.mPulses == b.mPulses && a.mBitCount == b.mBitCount && a.mData == b.mData &&
+           a.mWordStart == b.mWordStart && a.mDirection == b.mDirection && a.mWordEnd == b.mWordEnd &&
+           a.mWordGapValid == b.mWordGapValid && a.mPacketGapValid == b.mPacketGapValid && a.mPacket == b.mPacket &&
+           a.mPacketStart == b.mPacketStart && a.mPacketEnd == b.mPacketEnd && a.mPacketStartPulseEnd == b.mPacketStartPulseEnd &&
+           a.mLastPacket[ 0 ] == b.mLastPacket[ 0 ] && a.mLastPacket[ 1 ] == b.mLastPacket[ 1 ] &&
+           a.mHaveLastPacket[ 0 ] == b.mHaveLastPacket[ 0 ] && a.mHaveLastPacket[ 1 ] == b.mHaveLastPacket[ 1 ] &&
+           a.mPacketHeld == b.mPacketHeld && SameWords( a.mPacketWords, b.mPacketWords ) &&
+           a.mPacketBitMarkers == b.mPacketBitMarkers && a.mRepeatCount[ 0 ] == b.mRepeatCount[ 0 ] &&
+           a.mRepeatCount[ 1 ] == b.mRepeatCount[ 1 ] && a.mRepeatStart == b.mRepeatStart && a.mRepeatEnd == b.mRepeatEnd &&
+           a.mRepeatLastDirection == b.mRepeatLastDirection;
+}
+
+MiSpiDecodeCache::MiSpiDecodeCache()
+    : mState( CacheOff ),
+      mSampleRate( 0 ),
+      mFingerprint( 0 ),
+      mLastSample( 0 ),
+      mFileOffset( 0 ),
+      mReadOffset( 0 ),
+      mSegmentEnd( 0 ),
+      mReplaySample( 0 ),
+      mPlayedEnd( 0 ),
+      mPlayedSample( 0 )
+{
+}
+
+void MiSpiDecodeCache::Reset( const std::string& folder, const char* settings, U64 sample_rate )
+{
+    mState = folder.empty() ? CacheOff : CacheFingerprinting;
+    mFolder = folder;
+    mSettings = settings;
+    mSampleRate = sample_rate;
+    mPath.clear();
+    mLastSample = 0;
+    mBuffer.clear();
+    CloseFile();
+
+    // Different settings decode the same capture differently, so they're part of the fingerprint
+    mFingerprint = MISPI_FNV_OFFSET;
+    for( size_t i = 0; i < mSettings.size(); i++ )
+    {
+        mFingerprint = ( mFingerprint ^ ( U8 )mSettings[ i ] ) * MISPI_FNV_PRIME;
+    }
+    AddToFingerprint( sample_rate );
+}
+
+bool MiSpiDecodeCache::IsFingerprinting() const
+{
+    return mState == CacheFingerprinting;
+}
+
+bool MiSpiDecodeCache::IsRecording() const
+{
+    return mState == CacheRecording;
+}
+
+void MiSpiDecodeCache::AddToFingerprint( U64 value )
+{
+    for( U32 i = 0; i < 8; i++ )
+    {
+        mFingerprint = ( mFingerprint ^ ( U8 )( value >> ( i * 8 ) ) ) * MISPI_FNV_PRIME;
+    }
+}
+
+// Decoding caught up before the capture could be recognised, there's too little of it to be worth caching
+void MiSpiDecodeCache::CancelFingerprint()
+{
+    mState = CacheOff;
+}
+
+bool MiSpiDecodeCache::Load( const MiSpiDecodeCheckpoint& boundary )
+{
+    std::stringstream path;
+    path << mFolder;
+    if( mFolder[ mFolder.size() - 1 ] != '/' && mFolder[ mFolder.size() - 1 ] != '\\' )
+        path << '/';
+    path << "mispi-" << std::hex << std::setw( 16 ) << std::setfill( '0' ) << mFingerprint << ".cache";
+    mPath = path.str();
+
+    CloseFile();
+    mReader.open( mPath.c_str(), std::ios::in | std::ios::binary );
+
+    // The header has to match exactly, the fingerprint is only a hash
+    std::vector<U8> header;
+    header.insert( header.end(), MISPI_CACHE_MAGIC, MISPI_CACHE_MAGIC + strlen( MISPI_CACHE_MAGIC ) );
+    MiSpiAppendVarint( header, mSampleRate );
+    MiSpiAppendVarint( header, mSettings.size() );
+    header.insert( header.end(), mSettings.begin(), mSettings.end() );
+    MiSpiAppendVarint( header, mFingerprint );
+
+    while( mFile.size() < header.size() && ReadChunk() )
+    {
+    }
+    if( mFile.size() < header.size() || memcmp( &mFile[ 0 ], &header[ 0 ], header.size() ) != 0 )
+    {
+        CloseFile();
+        StartRecording( boundary );
+        return false;
+    }
+
+    // The recording starts with where decoding was at the end of the fingerprint, which is checked against the
+    // pulses already decoded here, so nothing past them has to be read to tell it's the same capture
+    U64 offset = header.size();
+    MiSpiDecodeRecord record;
+    mLastSample = 0;
+    if( !ParseNext( offset, record ) || record.mType != MiSpiRecordCheckpoint || !SameCheckpoint( record.mCheckpoint, boundary ) )
+    {
+        CloseFile();
+        StartRecording( boundary );
+        return false;
+    }
+
+    mState = CacheReplaying;
+    mReadOffset = offset;
+    mSegmentEnd = offset;
+    mReplaySample = boundary.mSample;
+    mPlayedEnd = offset;
+    mPlayedSample = boundary.mSample;
+    mLastSample = boundary.mSample;
+    return true;
+}
+
+bool MiSpiDecodeCache::NextSegment( MiSpiDecodeCheckpoint& checkpoint )
+{
+    if( mState != CacheReplaying )
+        return false;
+
+    // Only what comes after the segment handed out last is still needed
+    mFile.erase( mFile.begin(), mFile.begin() + mSegmentEnd );
+    mFileOffset += mSegmentEnd;
+    mReadOffset = 0;
+    mSegmentEnd = 0;
+
+    // Check the records hang together up to the checkpoint, they're parsed again as they're read
+    U64 offset = 0;
+    MiSpiDecodeRecord record;
+    mLastSample = mReplaySample;
+    do
+    {
+        if( !ParseNext( offset, record ) )
+        {
+            mLastSample = mReplaySample;
+            return false;
+        }
+    } while( record.mType != MiSpiRecordCheckpoint );
+
+    checkpoint = record.mCheckpoint;
+    mSegmentEnd = offset;
+    mLastSample = mReplaySample;
+    mReplaySample = checkpoint.mSample;
+    return true;
+}
+
+bool MiSpiDecodeCache::ReadRecord( MiSpiDecodeRecord& record )
+{
+    if( mState != CacheReplaying || mReadOffset >= mSegmentEnd )
+        return false;
+
+    const U8* begin = &mFile[ 0 ];
+    const U8* data = begin + mReadOffset;
+    bool valid = Parse( data, begin + mSegmentEnd, record );
+    mReadOffset = data - begin;
+    if( valid && mReadOffset == mSegmentEnd )
+    {
+        mPlayedEnd = mFileOffset + mSegmentEnd;
+        mPlayedSample = mLastSample;
+    }
+    return valid;
+}
+
+// New results are added after the last segment played back. Anything in the file past that is left over from a
+// decode that didn't get to its next checkpoint, or wasn't played back, and is dropped.
+void MiSpiDecodeCache::FinishReplay()
+{
+    bool played_all = mPlayedEnd == mFileOffset + mFile.size() && !ReadChunk();
+    CloseFile();
+    mBuffer.clear();
+    mState = CacheRecording;
+    mLastSample = mPlayedSample;
+
+    if( !played_all )
+        TruncateFile( mPlayedEnd );
+}
+
+void MiSpiDecodeCache::AddStart( MiSpiDirection direction, U64 start, U64 end )
+{
+    mBuffer.push_back( MiSpiRecordStart );
+    MiSpiAppendVarint( mBuffer, direction );
+    AppendSample( start );
+    AppendSample( end );
+}
+
+void MiSpiDecodeCache::AddWord( MiSpiDirection direction, U64 data, U64 start, U64 end )
+{
+    mBuffer.push_back( MiSpiRecordWord );
+    MiSpiAppendVarint( mBuffer, direction );
+    MiSpiAppendVarint( mBuffer, data );
+    AppendSample( start );
+    AppendSample( end );
+}
+
+void MiSpiDecodeCache::AddBitMarker( U64 sample )
+{
+    mBuffer.push_back( MiSpiRecordBitMarker );
+    AppendSample( sample );
+}
+
+void MiSpiDecodeCache::AddSync( U64 start, U64 end )
+{
+    mBuffer.push_back( MiSpiRecordSync );
+    AppendSample( start );
+    AppendSample( end );
+}
+
+void MiSpiDecodeCache::AddError( U64 start, U64 end )
+{
+    mBuffer.push_back( MiSpiRecordError );
+    AppendSample( start );
+    AppendSample( end );
+}
+
+void MiSpiDecodeCache::AddRepeat( U64 flags, U64 mosi_count, U64 miso_count, U64 start, U64 end )
+{
+    mBuffer.push_back( MiSpiRecordRepeat );
+    MiSpiAppendVarint( mBuffer, flags );
+    MiSpiAppendVarint( mBuffer, mosi_count );
+    MiSpiAppendVarint( mBuffer, miso_count );
+    AppendSample( start );
+    AppendSample( end );
+}
+
+void MiSpiDecodeCache::AddPacket( MiSpiDirection direction, const std::vector<U8>& payload, U64 start, U64 end, bool repeat )
+{
+    mBuffer.push_back( MiSpiRecordPacket );
+    MiSpiAppendVarint( mBuffer, direction );
+    MiSpiAppendVarint( mBuffer, repeat ? 1 : 0 );
+    AppendSample( start );
+    AppendSample( end );
+    AppendBytes( payload );
+}
+
+// Written whenever the decoder hands its timing over, the sample doubles as a check that it's the same capture
+void MiSpiDecodeCache::AddTiming( U64 sample, const MiSpiTimingHistogram* timing )
+{
+    mBuffer.push_back( MiSpiRecordTiming );
+    AppendSample( sample );
+    for( U32 i = 0; i < MiSpiTimingMetricCount; i++ )
+    {
+        timing[ i ].Save( mBuffer );
+    }
+
+    if( mBuffer.size() >= MISPI_CACHE_BUFFER_SIZE )
+        Flush();
+}
+
+void MiSpiDecodeCache::AddCheckpoint( const MiSpiDecodeCheckpoint& checkpoint )
+{
+    mBuffer.push_back( MiSpiRecordCheckpoint );
+    AppendSample( checkpoint.mSample );
+    MiSpiAppendVarint( mBuffer, checkpoint.mPulses );
+    MiSpiAppendVarint( mBuffer, checkpoint.mBitCount );
+    MiSpiAppendVarint( mBuffer, checkpoint.mData );
+    AppendSample( checkpoint.mWordStart );
+    MiSpiAppendVarint( mBuffer, checkpoint.mDirection );
+    AppendSample( checkpoint.mWordEnd );
+    MiSpiAppendVarint( mBuffer, ( checkpoint.mWordGapValid ? 1 : 0 ) | ( checkpoint.mPacketGapValid ? 2 : 0 ) |
+                                    ( checkpoint.mHaveLastPacket[ 0 ] ? 4 : 0 ) | ( checkpoint.mHaveLastPacket[ 1 ] ? 8 : 0 ) |
+                                    ( checkpoint.mPacketHeld ? 16 : 0 ) );
+    AppendBytes( checkpoint.mPacket );
+    AppendSample( checkpoint.mPacketStart );
+    AppendSample( checkpoint.mPacketEnd );
+    AppendSample( checkpoint.mPacketStartPulseEnd );
+    AppendBytes( checkpoint.mLastPacket[ 0 ] );
+    AppendBytes( checkpoint.mLastPacket[ 1 ] );
+    MiSpiAppendVarint( mBuffer, checkpoint.mPacketWords.size() );
+    for( size_t i = 0; i < checkpoint.mPacketWords.size(); i++ )
+    {
+        MiSpiAppendVarint( mBuffer, checkpoint.mPacketWords[ i ].mData );
+        AppendSample( checkpoint.mPacketWords[ i ].mStartingSampleInclusive );
+        AppendSample( checkpoint.mPacketWords[ i ].mEndingSampleInclusive );
+    }
+    MiSpiAppendVarint( mBuffer, checkpoint.mPacketBitMarkers.size() );
+    for( size_t i = 0; i < checkpoint.mPacketBitMarkers.size(); i++ )
+    {
+        AppendSample( checkpoint.mPacketBitMarkers[ i ] );
+    }
+    MiSpiAppendVarint( mBuffer, checkpoint.mRepeatCount[ 0 ] );
+    MiSpiAppendVarint( mBuffer, checkpoint.mRepeatCount[ 1 ] );
+    AppendSample( checkpoint.mRepeatStart );
+    AppendSample( checkpoint.mRepeatEnd );
+    MiSpiAppendVarint( mBuffer, checkpoint.mRepeatLastDirection );
+
+    // What follows is relative to the checkpoint, whichever decode writes it
+    mLastSample = checkpoint.mSample;
+    Flush();
+}
+
+bool MiSpiDecodeCache::Parse( const U8*& data, const U8* end, MiSpiDecodeRecord& record )
+{
+    if( data == end )
+        return false;
+
+    U64 direction = MiSpiDirUnknown;
+    U64 value;
+    // Check the type byte before it's an enum, anything past the last type is a torn or foreign file
+    U8 type = *data++;
+    if( type < MiSpiRecordStart || type > MiSpiRecordCheckpoint )
+        return false;
+    record.mType = ( MiSpiDecodeRecordType )type;
+    switch( record.mType )
+    {
+    case MiSpiRecordStart:
+        if( !MiSpiReadVarint( data, end, direction ) || !ReadSample( data, end, record.mStartingSampleInclusive ) ||
+            !ReadSample( data, end, record.mEndingSampleInclusive ) )
+            return false;
+        break;
+    case MiSpiRecordWord:
+        if( !MiSpiReadVarint( data, end, direction ) || !MiSpiReadVarint( data, end, record.mData1 ) ||
+            !ReadSample( data, end, record.mStartingSampleInclusive ) || !ReadSample( data, end, record.mEndingSampleInclusive ) )
+            return false;
+        break;
+    case MiSpiRecordBitMarker:
+        if( !ReadSample( data, end, record.mStartingSampleInclusive ) )
+            return false;
+        record.mEndingSampleInclusive = record.mStartingSampleInclusive;
+        break;
+    case MiSpiRecordSync:
+    case MiSpiRecordError:
+        if( !ReadSample( data, end, record.mStartingSampleInclusive ) || !ReadSample( data, end, record.mEndingSampleInclusive ) )
+            return false;
+        break;
+    case MiSpiRecordRepeat:
+        if( !MiSpiReadVarint( data, end, record.mFlags ) || !MiSpiReadVarint( data, end, record.mData1 ) ||
+            !MiSpiReadVarint( data, end, record.mData2 ) || !ReadSample( data, end, record.mStartingSampleInclusive ) ||
+            !ReadSample( data, end, record.mEndingSampleInclusive ) )
+            return false;
+        break;
+    case MiSpiRecordPacket:
+        if( !MiSpiReadVarint( data, end, direction ) || !MiSpiReadVarint( data, end, record.mFlags ) ||
+            !ReadSample( data, end, record.mStartingSampleInclusive ) || !ReadSample( data, end, record.mEndingSampleInclusive ) ||
+            !ReadBytes( data, end, record.mPayload ) )
+            return false;
+        break;
+    case MiSpiRecordTiming:
+        if( !ReadSample( data, end, record.mEndingSampleInclusive ) )
+            return false;
+        for( U32 i = 0; i < MiSpiTimingMetricCount; i++ )
+        {
+            if( !record.mTiming[ i ].Load( data, end ) )
+                return false;
+        }
+        break;
+    case MiSpiRecordCheckpoint:
+    {
+        MiSpiDecodeCheckpoint& checkpoint = record.mCheckpoint;
+        U64 bit_count;
+        U64 flags;
+        U64 count;
+        U64 repeat_direction;
+        if( !ReadSample( data, end, checkpoint.mSample ) || !MiSpiReadVarint( data, end, checkpoint.mPulses ) ||
+            !MiSpiReadVarint( data, end, bit_count ) || !MiSpiReadVarint( data, end, checkpoint.mData ) ||
+            !ReadSample( data, end, checkpoint.mWordStart ) || !MiSpiReadVarint( data, end, value ) ||
+            !ReadSample( data, end, checkpoint.mWordEnd ) || !MiSpiReadVarint( data, end, flags ) ||
+            !ReadBytes( data, end, checkpoint.mPacket ) || !ReadSample( data, end, checkpoint.mPacketStart ) ||
+            !ReadSample( data, end, checkpoint.mPacketEnd ) || !ReadSample( data, end, checkpoint.mPacketStartPulseEnd ) ||
+            !ReadBytes( data, end, checkpoint.mLastPacket[ 0 ] ) || !ReadBytes( data, end, checkpoint.mLastPacket[ 1 ] ) ||
+            value > MiSpiDirUnknown || !MiSpiReadVarint( data, end, count ) || count > U64( end - data ) )
+            return false;
+        checkpoint.mPacketWords.resize( count );
+        for( size_t i = 0; i < checkpoint.mPacketWords.size(); i++ )
+        {
+            if( !MiSpiReadVarint( data, end, checkpoint.mPacketWords[ i ].mData ) ||
+                !ReadSample( data, end, checkpoint.mPacketWords[ i ].mStartingSampleInclusive ) ||
+                !ReadSample( data, end, checkpoint.mPacketWords[ i ].mEndingSampleInclusive ) )
+                return false;
+        }
+        if( !MiSpiReadVarint( data, end, count ) || count > U64( end - data ) )
+            return false;
+        checkpoint.mPacketBitMarkers.resize( count );
+        for( size_t i = 0; i < checkpoint.mPacketBitMarkers.size(); i++ )
+        {
+            if( !ReadSample( data, end, checkpoint.mPacketBitMarkers[ i ] ) )
+                return false;
+        }
+        if( !MiSpiReadVarint( data, end, checkpoint.mRepeatCount[ 0 ] ) || !MiSpiReadVarint( data, end, checkpoint.mRepeatCount[ 1 ] ) ||
+            !ReadSample( data, end, checkpoint.mRepeatStart ) || !ReadSample( data, end, checkpoint.mRepeatEnd ) ||
+            !MiSpiReadVarint( data, end, repeat_direction ) || repeat_direction > MiSpiDirUnknown )
+            return false;
+        checkpoint.mRepeatLastDirection = ( MiSpiDirection )repeat_direction;
+        checkpoint.mBitCount = bit_count;
+        checkpoint.mDirection = ( MiSpiDirection )value;
+        checkpoint.mWordGapValid = ( flags & 1 ) != 0;
+        checkpoint.mPacketGapValid = ( flags & 2 ) != 0;
+        checkpoint.mHaveLastPacket[ 0 ] = ( flags & 4 ) != 0;
+        checkpoint.mHaveLastPacket[ 1 ] = ( flags & 8 ) != 0;
+        checkpoint.mPacketHeld = ( flags & 16 ) != 0;
+        mLastSample = checkpoint.mSample;
+        break;
+    }
+    default:
+        return false;
+    }
+
+    if( direction > MiSpiDirUnknown )
+        return false;
+    record.mDirection = ( MiSpiDirection )direction;
+    return true;
+}
+
+bool MiSpiDecodeCache::ReadSample( const U8*& data, const U8* end, U64& sample )
+{
+    U64 delta;
+    if( !MiSpiReadVarint( data, end, delta ) )
+        return false;
+    mLastSample += MiSpiUnZigZag( delta );
+    sample = mLastSample;
+    return true;
+}
+
+bool MiSpiDecodeCache::ReadBytes( const U8*& data, const U8* end, std::vector<U8>& bytes )
+{
+    U64 length;
+    if( !MiSpiReadVarint( data, end, length ) || length > U64( end - data ) )
+        return false;
+    bytes.assign( data, data + length );
+    data += length;
+    return true;
+}
+
+void MiSpiDecodeCache::AppendSample( U64 sample )
+{
+    MiSpiAppendVarint( mBuffer, MiSpiZigZag( sample - mLastSample ) );
+    mLastSample = sample;
+}
+
+void MiSpiDecodeCache::AppendBytes( const std::vector<U8>& bytes )
+{
+    MiSpiAppendVarint( mBuffer, bytes.size() );
+    mBuffer.insert( mBuffer.end(), bytes.begin(), bytes.end() );
+}
+
+// Parses the record at offset in mFile, reading more of the file if it runs past what's been read so far
+bool MiSpiDecodeCache::ParseNext( U64& offset, MiSpiDecodeRecord& record )
+{
+    U64 last_sample = mLastSample;
+    for( ;; )
+    {
+        if( offset < mFile.size() )
+        {
+            const U8* begin = &mFile[ 0 ];
+            const U8* data = begin + offset;
+            if( Parse( data, begin + mFile.size(), record ) )
+            {
+                offset = data - begin;
+                return true;
+            }
+            mLastSample = last_sample;
+
+            // No record is that long, the file is damaged here
+            if( mFile.size() - offset > MISPI_CACHE_RECORD_LIMIT )
+                return false;
+        }
+
+        if( !ReadChunk() )
+            return false;
+    }
+}
+
+bool MiSpiDecodeCache::ReadChunk()
+{
+    if( !mReader.is_open() )
+        return false;
+
+    size_t size = mFile.size();
+    mFile.resize( size + MISPI_CACHE_BUFFER_SIZE );
+    mReader.read( ( char* )&mFile[ size ], MISPI_CACHE_BUFFER_SIZE );
+    mFile.resize( size + ( size_t )mReader.gcount() );
+    return mFile.size() > size;
+}
+
+void MiSpiDecodeCache::CloseFile()
+{
+    mReader.close();
+    mReader.clear();
+    std::vector<U8>().swap( mFile );
+    mFileOffset = 0;
+    mReadOffset = 0;
+    mSegmentEnd = 0;
+}
+
+// Keeps the start of the file, copied a chunk at a time to a new file that then takes its place
+void MiSpiDecodeCache::TruncateFile( U64 length )
+{
+    std::string temp_path = mPath + ".tmp";
+    std::ifstream file( mPath.c_str(), std::ios::in | std::ios::binary );
+    void* temp = AnalyzerHelpers::StartFile( temp_path.c_str(), false );
+    if( !file || temp == NULL )
+    {
+        if( temp != NULL )
+            AnalyzerHelpers::EndFile( temp );
+        mState = CacheOff;
+        return;
+    }
+
+    std::vector<U8> chunk( MISPI_CACHE_BUFFER_SIZE );
+    while( length > 0 )
+    {
+        U32 size = length > MISPI_CACHE_BUFFER_SIZE ? MISPI_CACHE_BUFFER_SIZE : ( U32 )length;
+        file.read( ( char* )&chunk[ 0 ], size );
+        if( file.gcount() != size )
+            break;
+        AnalyzerHelpers::AppendToFile( &chunk[ 0 ], size, temp );
+        length -= size;
+    }
+    AnalyzerHelpers::EndFile( temp );
+    file.close();
+
+    if( length > 0 || remove( mPath.c_str() ) != 0 || rename( temp_path.c_str(), mPath.c_str() ) != 0 )
+    {
+        remove( temp_path.c_str() );
+        mState = CacheOff;
+    }
+}
+
+// A new file replaces whatever was there, starting with the decoder state at the end of the fingerprint
+void MiSpiDecodeCache::StartRecording( const MiSpiDecodeCheckpoint& boundary )
+{
+    mState = CacheRecording;
+    mLastSample = 0;
+    mBuffer.clear();
+    mBuffer.insert( mBuffer.end(), MISPI_CACHE_MAGIC, MISPI_CACHE_MAGIC + strlen( MISPI_CACHE_MAGIC ) );
+    MiSpiAppendVarint( mBuffer, mSampleRate );
+    MiSpiAppendVarint( mBuffer, mSettings.size() );
+    mBuffer.insert( mBuffer.end(), mSettings.begin(), mSettings.end() );
+    MiSpiAppendVarint( mBuffer, mFingerprint );
+
+    WriteFile( &mBuffer[ 0 ], mBuffer.size(), false );
+    mBuffer.clear();
+
+    AddCheckpoint( boundary );
+}
+
+void MiSpiDecodeCache::Flush()
+{
+    if( mState != CacheRecording || mBuffer.empty() )
+        return;
+
+    WriteFile( &mBuffer[ 0 ], mBuffer.size(), true );
+    mBuffer.clear();
+}
+
+// The file is only held open while writing, so it's complete up to the last checkpoint whatever happens to the decode
+void MiSpiDecodeCache::WriteFile( const U8* data, U64 length, bool append )
+{
+    void* file = AnalyzerHelpers::StartFile( mPath.c_str(), append );
+    if( file == NULL )
+    {
+        // Nowhere to put it, decode without the cache
+        mState = CacheOff;
+        return;
+    }
+
+    while( length > 0 )
+    {
+        U32 chunk = length > MISPI_CACHE_BUFFER_SIZE ? MISPI_CACHE_BUFFER_SIZE : ( U32 )length;
+        AnalyzerHelpers::AppendToFile( data, chunk, file );
+        data += chunk;
+        length -= chunk;
+    }
+    AnalyzerHelpers::EndFile( file );
+}
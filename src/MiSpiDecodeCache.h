@@ -0,0 +1,164 @@
+#ifndef MISPI_DECODE_CACHE
+#define MISPI_DECODE_CACHE
+
+#include <AnalyzerTypes.h>
+#include "MiSpiTypes.h"
+#include "MiSpiTimingHistogram.h"
+#include <fstream>
+#include <string>
+#include <vector>
+
+// Number of clock pulses that identify a capture
+#define MISPI_CACHE_FINGERPRINT_PULSES 4096
+
+enum MiSpiDecodeRecordType {
+  MiSpiRecordStart = 1,
+  MiSpiRecordWord,
+  MiSpiRecordBitMarker,
+  MiSpiRecordSync,
+  MiSpiRecordError,
+  MiSpiRecordRepeat,
+  MiSpiRecordPacket,
+  MiSpiRecordTiming,
+  MiSpiRecordCheckpoint
+};
+
+// Decoder state at a point where its timing had just been handed over, enough to carry on from there
+struct MiSpiDecodeCheckpoint
+{
+    U64 mSample; // trailing edge of the last clock pulse decoded
+    U64 mPulses;
+
+    U32 mBitCount;
+    U64 mData;
+    U64 mWordStart;
+    MiSpiDirection mDirection;
+    U64 mWordEnd;
+    bool mWordGapValid;
+    bool mPacketGapValid;
+
+    std::vector<U8> mPacket;
+    U64 mPacketStart;
+    U64 mPacketEnd;
+    U64 mPacketStartPulseEnd;
+    std::vector<U8> mLastPacket[ 2 ];
+    bool mHaveLastPacket[ 2 ];
+
+    // Results held back to fold repeats, a checkpoint doesn't have to wait for them to be shown
+    bool mPacketHeld;
+    std::vector<MiSpiWord> mPacketWords;
+    std::vector<U64> mPacketBitMarkers;
+    U64 mRepeatCount[ 2 ];
+    U64 mRepeatStart;
+    U64 mRepeatEnd;
+    MiSpiDirection mRepeatLastDirection;
+};
+
+struct MiSpiDecodeRecord
+{
+    MiSpiDecodeRecordType mType;
+    MiSpiDirection mDirection;
+    U64 mFlags;
+    U64 mData1;
+    U64 mData2;
+    U64 mStartingSampleInclusive;
+    U64 mEndingSampleInclusive;
+    std::vector<U8> mPayload;
+    MiSpiTimingHistogram mTiming[ MiSpiTimingMetricCount ];
+    MiSpiDecodeCheckpoint mCheckpoint;
+};
+
+// Opt in on disk cache of what was decoded from a capture, so reopening it doesn't mean decoding it all again.
+//
+// A capture is recognised by the edges of its first few thousand clock pulses, the data bits sampled on them,
+// the sample rate and the settings that affect decoding. Decoding stops to look for a cache file once that many
+// pulses are in; if there is one and it starts from the same decoder state, the results recorded after that point
+// are played back a checkpoint at a time, each once the capture's clock pulses are found to end where it says, and
+// decoding carries on from the last checkpoint that matched. Otherwise results are recorded from there on. The file
+// is read a chunk at a time, so it never has to fit in memory. Records are a tag byte followed by varints, sample
+// numbers relative to the previous one, and a checkpoint is written along with the timing every 65536 pulses and
+// when the bus goes quiet. Anything in the file after the last checkpoint is ignored.
+class MiSpiDecodeCache
+{
+  public:
+    MiSpiDecodeCache();
+
+    void Reset( const std::string& folder, const char* settings, U64 sample_rate );
+    bool IsFingerprinting() const;
+    bool IsRecording() const;
+
+    void AddToFingerprint( U64 value );
+    void CancelFingerprint();
+
+    // Once the fingerprint pulses are in, true if there's a cache that was recorded from the same decoder state
+    // to play back. If not, recording starts from that state.
+    bool Load( const MiSpiDecodeCheckpoint& boundary );
+
+    // Reads ahead to the next checkpoint in the file, false once there isn't a complete one. The records up to and
+    // including it are then handed out by ReadRecord.
+    bool NextSegment( MiSpiDecodeCheckpoint& checkpoint );
+    bool ReadRecord( MiSpiDecodeRecord& record );
+
+    // Recording carries on from the last segment that was read through, anything after it is dropped from the file
+    void FinishReplay();
+
+    void AddStart( MiSpiDirection direction, U64 start, U64 end );
+    void AddWord( MiSpiDirection direction, U64 data, U64 start, U64 end );
+    void AddBitMarker( U64 sample );
+    void AddSync( U64 start, U64 end );
+    void AddError( U64 start, U64 end );
+    void AddRepeat( U64 flags, U64 mosi_count, U64 miso_count, U64 start, U64 end );
+    void AddPacket( MiSpiDirection direction, const std::vector<U8>& payload, U64 start, U64 end, bool repeat );
+    void AddTiming( U64 sample, const MiSpiTimingHistogram* timing );
+    void AddCheckpoint( const MiSpiDecodeCheckpoint& checkpoint );
+
+  protected:
+    enum CacheState
+    {
+        CacheOff,
+        CacheFingerprinting,
+        CacheReplaying,
+        CacheRecording
+    };
+
+    bool Parse( const U8*& data, const U8* end, MiSpiDecodeRecord& record );
+    bool ParseNext( U64& offset, MiSpiDecodeRecord& record );
+    bool ReadChunk();
+    void CloseFile();
+    void TruncateFile( U64 length );
+    bool ReadSample( const U8*& data, const U8* end, U64& sample );
+    bool ReadBytes( const U8*& data, const U8* end, std::vector<U8>& bytes );
+    void AppendSample( U64 sample );
+    void AppendBytes( const std::vector<U8>& bytes );
+    void StartRecording( const MiSpiDecodeCheckpoint& boundary );
+    void Flush();
+    void WriteFile( const U8* data, U64 length, bool append );
+
+    CacheState mState;
+    std::string mFolder;
+    std::string mSettings;
+    U64 mSampleRate;
+    U64 mFingerprint;
+    std::string mPath;
+
+    // Sample numbers are written relative to the last one
+    U64 mLastSample;
+
+    // Records not written to the file yet
+    std::vector<U8> mBuffer;
+
+    // The file being played back, read from mFileOffset on. The segment handed out ends at mSegmentEnd in mFile,
+    // and samples in the one after it are relative to mReplaySample.
+    std::ifstream mReader;
+    std::vector<U8> mFile;
+    U64 mFileOffset;
+    U64 mReadOffset;
+    U64 mSegmentEnd;
+    U64 mReplaySample;
+
+    // End of the last segment read through, and the sample of its checkpoint
+    U64 mPlayedEnd;
+    U64 mPlayedSample;
+};
+
+#endif // MISPI_DECODE_CACHE
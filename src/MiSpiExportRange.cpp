@@ -0,0 +1,125 @@
+#include "MiSpiExportRange.h"
+
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+
+MiSpiExportRange::MiSpiExportRange() : mEmpty( true )
+{
+    mStart.mIsTime = false;
+    mStart.mSample = 0;
+    mStart.mSeconds = 0;
+    mEnd = mStart;
+}
+
+bool MiSpiExportRange::Compile( const char* text )
+{
+    mEmpty = true;
+    mError.clear();
+    mText.clear();
+
+    if( text == NULL )
+        return true;
+
+    // Lower case everything up front so the units only have one spelling
+    for( const char* c = text; *c != '\0'; c++ )
+    {
+        if( !isspace( ( unsigned char )*c ) )
+            mText.push_back( tolower( ( unsigned char )*c ) );
+    }
+    if( mText.empty() )
+        return true;
+
+    const char* position = mText.c_str();
+    if( ParseEnd( position, mStart ) == false )
+        return false;
+    if( *position != '-' )
+        return Fail( "expected A-B" );
+    position++;
+    if( ParseEnd( position, mEnd ) == false )
+        return false;
+    if( *position != '\0' )
+        return Fail( "unexpected characters after the end of the range" );
+
+    if( mStart.mIsTime == mEnd.mIsTime &&
+        ( mStart.mIsTime ? mEnd.mSeconds < mStart.mSeconds : mEnd.mSample < mStart.mSample ) )
+        return Fail( "the end is before the start" );
+
+    mEmpty = false;
+    return true;
+}
+
+const char* MiSpiExportRange::GetError() const
+{
+    return mError.c_str();
+}
+
+bool MiSpiExportRange::IsEmpty() const
+{
+    return mEmpty;
+}
+
+void MiSpiExportRange::Resolve( U64 sample_rate, U64 trigger_sample, U64& start_sample, U64& end_sample ) const
+{
+    if( mEmpty )
+    {
+        start_sample = 0;
+        end_sample = ~0ULL;
+        return;
+    }
+
+    start_sample = ToSample( mStart, sample_rate, trigger_sample );
+    end_sample = ToSample( mEnd, sample_rate, trigger_sample );
+}
+
+bool MiSpiExportRange::ParseEnd( const char*& text, End& end )
+{
+    char* number_end;
+    double value = strtod( text, &number_end );
+    if( number_end == text )
+        return Fail( "expected a sample number or a time" );
+
+    static const char* units[] = { "ns", "us", "ms", "s" };
+    static const double seconds_per_unit[] = { 1e-9, 1e-6, 1e-3, 1 };
+    for( U32 i = 0; i < 4; i++ )
+    {
+        size_t length = strlen( units[ i ] );
+        if( strncmp( number_end, units[ i ], length ) == 0 )
+        {
+            end.mIsTime = true;
+            end.mSeconds = value * seconds_per_unit[ i ];
+            text = number_end + length;
+            return true;
+        }
+    }
+
+    // No unit, so it has to be a whole sample number
+    if( *text == '-' || *text == '+' )
+        return Fail( "sample numbers can't have a sign, give a time with a unit instead" );
+    char* sample_end;
+    end.mIsTime = false;
+    end.mSample = strtoull( text, &sample_end, 10 );
+    if( sample_end != number_end )
+        return Fail( "sample numbers must be whole numbers" );
+    text = sample_end;
+    return true;
+}
+
+bool MiSpiExportRange::Fail( const char* reason )
+{
+    mError = "Export range: " + std::string( reason ) + " in '" + mText + "'";
+    return false;
+}
+
+U64 MiSpiExportRange::ToSample( const End& end, U64 sample_rate, U64 trigger_sample )
+{
+    if( !end.mIsTime )
+        return end.mSample;
+
+    double sample = double( trigger_sample ) + end.mSeconds * double( sample_rate );
+    if( !( sample > 0 ) )
+        return 0;
+    if( sample >= 18446744073709551615.0 )
+        return ~0ULL;
+    return U64( sample + 0.5 );
+}
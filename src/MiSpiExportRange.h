@@ -0,0 +1,44 @@
+#ifndef MISPI_EXPORT_RANGE
+#define MISPI_EXPORT_RANGE
+
+#include <AnalyzerTypes.h>
+#include <string>
+
+// Parsed form of the "Export Range" setting, "A-B" with both ends inclusive.
+//
+// An end without a unit is a sample number. An end with a unit of s, ms, us or ns is a time relative
+// to the trigger, as shown on the timeline, and may be negative, e.g. "-2.5ms-10ms". An empty range
+// is the whole capture.
+class MiSpiExportRange
+{
+  public:
+    MiSpiExportRange();
+
+    bool Compile( const char* text );
+    const char* GetError() const;
+    bool IsEmpty() const;
+
+    // Sample numbers of the two ends, clamped at the start of the capture
+    void Resolve( U64 sample_rate, U64 trigger_sample, U64& start_sample, U64& end_sample ) const;
+
+  protected:
+    struct End
+    {
+        bool mIsTime;
+        U64 mSample;
+        double mSeconds;
+    };
+
+    bool ParseEnd( const char*& text, End& end );
+    bool Fail( const char* reason );
+
+    static U64 ToSample( const End& end, U64 sample_rate, U64 trigger_sample );
+
+    bool mEmpty;
+    End mStart;
+    End mEnd;
+    std::string mText;
+    std::string mError;
+};
+
+#endif // MISPI_EXPORT_RANGE
@@ -0,0 +1,91 @@
+#include "MiSpiExportWriter.h"
+
+#include <AnalyzerHelpers.h>
+
+#define MISPI_EXPORT_BUFFER_SIZE ( 64 * 1024 )
+
+MiSpiExportWriter::MiSpiExportWriter() : mFile( NULL ), mFilter( NULL )
+{
+}
+
+// Only lets go of a file that wasn't closed, the virtual Close() can't be reached from here
+MiSpiExportWriter::~MiSpiExportWriter()
+{
+    if( mFile != NULL )
+        AnalyzerHelpers::EndFile( mFile );
+}
+
+void MiSpiExportWriter::Open( const char* file )
+{
+    mFile = AnalyzerHelpers::StartFile( file );
+    mBuffer.clear();
+    mBuffer.reserve( MISPI_EXPORT_BUFFER_SIZE );
+}
+
+void MiSpiExportWriter::Close()
+{
+    if( mFile == NULL )
+        return;
+
+    Flush();
+    AnalyzerHelpers::EndFile( mFile );
+    mFile = NULL;
+}
+
+void MiSpiExportWriter::SetFilter( const MiSpiPacketFilter* filter )
+{
+    mFilter = filter;
+}
+
+bool MiSpiExportWriter::Matches( MiSpiDirection direction, const std::vector<U64>& packet, U64 start_sample, U64 end_sample ) const
+{
+    return mFilter == NULL || mFilter->Matches( direction, packet, start_sample, end_sample );
+}
+
+// Writers only override what they write out
+void MiSpiExportWriter::WritePacket( MiSpiDirection /*direction*/, const std::vector<U64>& /*packet*/, U64 /*start_sample*/,
+                                     U64 /*end_sample*/ )
+{
+}
+
+void MiSpiExportWriter::WriteRepeat( MiSpiDirection /*direction*/, const std::vector<U64>& /*packet*/, U64 /*count*/,
+                                     U64 /*start_sample*/, U64 /*end_sample*/ )
+{
+}
+
+void MiSpiExportWriter::WriteLine( MiSpiDirection /*direction*/, const std::vector<U64>& /*packet*/, U64 /*repeats*/,
+                                   U64 /*start_sample*/, U64 /*end_sample*/ )
+{
+}
+
+void MiSpiExportWriter::WriteSync( U64 /*start_sample*/, U64 /*end_sample*/ )
+{
+}
+
+void MiSpiExportWriter::WriteError( U64 /*start_sample*/, U64 /*end_sample*/ )
+{
+}
+
+void MiSpiExportWriter::Append( const U8* data, U32 length )
+{
+    mBuffer.insert( mBuffer.end(), data, data + length );
+}
+
+void MiSpiExportWriter::Append( const std::string& text )
+{
+    Append( ( const U8* )text.c_str(), text.length() );
+}
+
+// Called between records, so a record is never split across two writes
+void MiSpiExportWriter::FlushIfFull()
+{
+    if( mBuffer.size() >= MISPI_EXPORT_BUFFER_SIZE )
+        Flush();
+}
+
+void MiSpiExportWriter::Flush()
+{
+    if( !mBuffer.empty() )
+        AnalyzerHelpers::AppendToFile( &mBuffer[ 0 ], mBuffer.size(), mFile );
+    mBuffer.clear();
+}
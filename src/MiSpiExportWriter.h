@@ -0,0 +1,54 @@
+#ifndef MISPI_EXPORT_WRITER
+#define MISPI_EXPORT_WRITER
+
+#include <AnalyzerTypes.h>
+#include "MiSpiTypes.h"
+#include "MiSpiPacketFilter.h"
+#include <string>
+#include <vector>
+
+// One output file of an export.
+//
+// The frames are walked, and packets put back together and deduplicated, once per export, however
+// many files it writes. Each writer is told about every packet as it goes and keeps its output in
+// its own buffer, which is handed to the file whenever a record leaves it over 64 KB.
+class MiSpiExportWriter
+{
+  public:
+    MiSpiExportWriter();
+    virtual ~MiSpiExportWriter();
+
+    virtual void Open( const char* file );
+
+    // Writes whatever the writer keeps until the end and finishes the file. It has to be called, the
+    // destructor only closes the file without writing anything more.
+    virtual void Close();
+
+    // Packets that don't match aren't passed to WritePacket, WriteRepeat and WriteLine, NULL matches everything
+    void SetFilter( const MiSpiPacketFilter* filter );
+    bool Matches( MiSpiDirection direction, const std::vector<U64>& packet, U64 start_sample, U64 end_sample ) const;
+
+    // Every packet as it was decoded
+    virtual void WritePacket( MiSpiDirection direction, const std::vector<U64>& packet, U64 start_sample, U64 end_sample );
+
+    // Repeats of the last packet in a direction that the decoder folded into a Repeat frame
+    virtual void WriteRepeat( MiSpiDirection direction, const std::vector<U64>& packet, U64 count, U64 start_sample, U64 end_sample );
+
+    // A packet and the repeats of it that followed in the same direction, once a different one comes along
+    virtual void WriteLine( MiSpiDirection direction, const std::vector<U64>& packet, U64 repeats, U64 start_sample, U64 end_sample );
+
+    virtual void WriteSync( U64 start_sample, U64 end_sample );
+    virtual void WriteError( U64 start_sample, U64 end_sample );
+
+  protected:
+    void Append( const U8* data, U32 length );
+    void Append( const std::string& text );
+    void FlushIfFull();
+    void Flush();
+
+    void* mFile;
+    std::vector<U8> mBuffer;
+    const MiSpiPacketFilter* mFilter;
+};
+
+#endif // MISPI_EXPORT_WRITER
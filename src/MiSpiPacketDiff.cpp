@@ -0,0 +1,257 @@
+#include "MiSpiPacketDiff.h"
+
+#include <algorithm>
+#include <unordered_map>
+
+void MiSpiPacketDiff::Diff( const std::vector<U64>& reference, const std::vector<U64>& capture, std::vector<MiSpiDiffEdit>& edits )
+{
+    edits.clear();
+
+    // Stretches still to align and runs already matched, taken off the back so they come out in order
+    std::vector<Range> stack;
+    Range all = { 0, reference.size(), 0, capture.size(), false };
+    stack.push_back( all );
+
+    std::vector<Range> anchors;
+    while( !stack.empty() )
+    {
+        Range range = stack.back();
+        stack.pop_back();
+
+        if( range.mAnchor )
+        {
+            for( U64 i = 0; i < range.mReferenceEnd - range.mReferenceStart; i++ )
+            {
+                AddEdit( edits, MiSpiDiffSame, range.mReferenceStart + i, range.mCaptureStart + i );
+            }
+            continue;
+        }
+
+        // Whatever the two have in common at the start and end needs no searching
+        while( range.mReferenceStart < range.mReferenceEnd && range.mCaptureStart < range.mCaptureEnd &&
+               reference[ range.mReferenceStart ] == capture[ range.mCaptureStart ] )
+        {
+            AddEdit( edits, MiSpiDiffSame, range.mReferenceStart++, range.mCaptureStart++ );
+        }
+        U64 suffix = 0;
+        while( range.mReferenceStart + suffix < range.mReferenceEnd && range.mCaptureStart + suffix < range.mCaptureEnd &&
+               reference[ range.mReferenceEnd - 1 - suffix ] == capture[ range.mCaptureEnd - 1 - suffix ] )
+        {
+            suffix++;
+        }
+        if( suffix > 0 )
+        {
+            Range common = { range.mReferenceEnd - suffix, range.mReferenceEnd, range.mCaptureEnd - suffix, range.mCaptureEnd, true };
+            stack.push_back( common );
+            range.mReferenceEnd -= suffix;
+            range.mCaptureEnd -= suffix;
+        }
+
+        // With one side empty, the other is all removed or all inserted
+        if( range.mReferenceStart == range.mReferenceEnd || range.mCaptureStart == range.mCaptureEnd )
+        {
+            Replace( range, edits );
+            continue;
+        }
+
+        FindAnchors( reference, capture, range, anchors );
+        if( anchors.empty() )
+        {
+            Myers( reference, capture, range, edits );
+            continue;
+        }
+
+        // The stretch after the last anchor goes on first, so it comes off last
+        Range gap = range;
+        for( size_t i = anchors.size(); i-- > 0; )
+        {
+            gap.mReferenceStart = anchors[ i ].mReferenceEnd;
+            gap.mCaptureStart = anchors[ i ].mCaptureEnd;
+            stack.push_back( gap );
+            stack.push_back( anchors[ i ] );
+            gap.mReferenceEnd = anchors[ i ].mReferenceStart;
+            gap.mCaptureEnd = anchors[ i ].mCaptureStart;
+        }
+        gap.mReferenceStart = range.mReferenceStart;
+        gap.mCaptureStart = range.mCaptureStart;
+        stack.push_back( gap );
+    }
+}
+
+// Hashes found exactly once on each side, in the longest order both sides agree on
+void MiSpiPacketDiff::FindAnchors( const std::vector<U64>& reference, const std::vector<U64>& capture, const Range& range,
+                                   std::vector<Range>& anchors )
+{
+    anchors.clear();
+
+    struct Occurrences
+    {
+        U64 mReferenceCount;
+        U64 mCaptureCount;
+        U64 mCaptureIndex;
+    };
+    std::unordered_map<U64, Occurrences> occurrences;
+    occurrences.reserve( range.mReferenceEnd - range.mReferenceStart );
+    for( U64 i = range.mReferenceStart; i < range.mReferenceEnd; i++ )
+    {
+        Occurrences& entry = occurrences[ reference[ i ] ];
+        entry.mReferenceCount++;
+    }
+    for( U64 i = range.mCaptureStart; i < range.mCaptureEnd; i++ )
+    {
+        std::unordered_map<U64, Occurrences>::iterator entry = occurrences.find( capture[ i ] );
+        if( entry != occurrences.end() )
+        {
+            entry->second.mCaptureCount++;
+            entry->second.mCaptureIndex = i;
+        }
+    }
+
+    std::vector<U64> reference_indexes;
+    std::vector<U64> capture_indexes;
+    for( U64 i = range.mReferenceStart; i < range.mReferenceEnd; i++ )
+    {
+        const Occurrences& entry = occurrences[ reference[ i ] ];
+        if( entry.mReferenceCount == 1 && entry.mCaptureCount == 1 )
+        {
+            reference_indexes.push_back( i );
+            capture_indexes.push_back( entry.mCaptureIndex );
+        }
+    }
+    if( reference_indexes.empty() )
+        return;
+
+    // Longest increasing run of capture indexes by patience sorting, each pile top remembers what was under it
+    std::vector<size_t> piles;
+    std::vector<size_t> previous( capture_indexes.size() );
+    for( size_t i = 0; i < capture_indexes.size(); i++ )
+    {
+        size_t low = 0;
+        size_t high = piles.size();
+        while( low < high )
+        {
+            size_t middle = ( low + high ) / 2;
+            if( capture_indexes[ piles[ middle ] ] < capture_indexes[ i ] )
+                low = middle + 1;
+            else
+                high = middle;
+        }
+        previous[ i ] = ( low > 0 ) ? piles[ low - 1 ] : i;
+        if( low == piles.size() )
+            piles.push_back( i );
+        else
+            piles[ low ] = i;
+    }
+
+    size_t i = piles.back();
+    while( true )
+    {
+        Range anchor = { reference_indexes[ i ], reference_indexes[ i ] + 1, capture_indexes[ i ], capture_indexes[ i ] + 1, true };
+        anchors.push_back( anchor );
+        if( previous[ i ] == i )
+            break;
+        i = previous[ i ];
+    }
+    std::reverse( anchors.begin(), anchors.end() );
+}
+
+// Shortest edit script of a stretch, or all of it replaced if that takes more than MISPI_DIFF_MAX_EDITS
+void MiSpiPacketDiff::Myers( const std::vector<U64>& reference, const std::vector<U64>& capture, const Range& range,
+                             std::vector<MiSpiDiffEdit>& edits )
+{
+    S64 n = range.mReferenceEnd - range.mReferenceStart;
+    S64 m = range.mCaptureEnd - range.mCaptureStart;
+    S64 max_edits = std::min<S64>( n + m, MISPI_DIFF_MAX_EDITS );
+
+    // Furthest reference position on each diagonal k = x - y, one row kept per number of edits
+    std::vector<S64> v( 2 * max_edits + 3, 0 );
+    S64 offset = max_edits + 1;
+    std::vector<std::vector<S64> > rows;
+    bool found = false;
+    for( S64 d = 0; d <= max_edits && !found; d++ )
+    {
+        for( S64 k = -d; k <= d; k += 2 )
+        {
+            S64 x;
+            if( k == -d || ( k != d && v[ offset + k - 1 ] < v[ offset + k + 1 ] ) )
+                x = v[ offset + k + 1 ];
+            else
+                x = v[ offset + k - 1 ] + 1;
+            S64 y = x - k;
+            while( x < n && y < m && reference[ range.mReferenceStart + x ] == capture[ range.mCaptureStart + y ] )
+            {
+                x++;
+                y++;
+            }
+            v[ offset + k ] = x;
+            if( x >= n && y >= m )
+                found = true;
+        }
+        rows.push_back( std::vector<S64>( v.begin() + offset - d, v.begin() + offset + d + 1 ) );
+    }
+
+    if( !found )
+    {
+        Replace( range, edits );
+        return;
+    }
+
+    // Walk back from the end through the rows, then put the script the right way round
+    size_t first_edit = edits.size();
+    S64 x = n;
+    S64 y = m;
+    for( S64 d = rows.size() - 1; d > 0; d-- )
+    {
+        const std::vector<S64>& previous = rows[ d - 1 ];
+        S64 k = x - y;
+        S64 previous_k;
+        if( k == -d || ( k != d && previous[ k - 1 + d - 1 ] < previous[ k + 1 + d - 1 ] ) )
+            previous_k = k + 1;
+        else
+            previous_k = k - 1;
+        S64 previous_x = previous[ previous_k + d - 1 ];
+        S64 previous_y = previous_x - previous_k;
+
+        while( x > previous_x && y > previous_y )
+        {
+            x--;
+            y--;
+            AddEdit( edits, MiSpiDiffSame, range.mReferenceStart + x, range.mCaptureStart + y );
+        }
+        if( previous_k == k + 1 )
+            AddEdit( edits, MiSpiDiffInserted, range.mReferenceStart + x, range.mCaptureStart + previous_y );
+        else
+            AddEdit( edits, MiSpiDiffRemoved, range.mReferenceStart + previous_x, range.mCaptureStart + y );
+        x = previous_x;
+        y = previous_y;
+    }
+    while( x > 0 && y > 0 )
+    {
+        x--;
+        y--;
+        AddEdit( edits, MiSpiDiffSame, range.mReferenceStart + x, range.mCaptureStart + y );
+    }
+    std::reverse( edits.begin() + first_edit, edits.end() );
+}
+
+// The whole reference side of a stretch removed and the whole capture side inserted
+void MiSpiPacketDiff::Replace( const Range& range, std::vector<MiSpiDiffEdit>& edits )
+{
+    for( U64 i = range.mReferenceStart; i < range.mReferenceEnd; i++ )
+    {
+        AddEdit( edits, MiSpiDiffRemoved, i, range.mCaptureStart );
+    }
+    for( U64 i = range.mCaptureStart; i < range.mCaptureEnd; i++ )
+    {
+        AddEdit( edits, MiSpiDiffInserted, range.mReferenceEnd, i );
+    }
+}
+
+void MiSpiPacketDiff::AddEdit( std::vector<MiSpiDiffEdit>& edits, MiSpiDiffOp op, U64 reference_index, U64 capture_index )
+{
+    MiSpiDiffEdit edit;
+    edit.mOp = op;
+    edit.mReferenceIndex = reference_index;
+    edit.mCaptureIndex = capture_index;
+    edits.push_back( edit );
+}
@@ -0,0 +1,54 @@
+#ifndef MISPI_PACKET_DIFF
+#define MISPI_PACKET_DIFF
+
+#include <AnalyzerTypes.h>
+#include <vector>
+
+// Most edits Myers' algorithm looks for in a stretch between two anchors, it keeps a row per edit
+// so this bounds its memory to a few MB. Stretches that differ more are reported as replaced.
+#define MISPI_DIFF_MAX_EDITS 1024
+
+enum MiSpiDiffOp {
+  MiSpiDiffSame,
+  MiSpiDiffRemoved,
+  MiSpiDiffInserted
+};
+
+struct MiSpiDiffEdit
+{
+    MiSpiDiffOp mOp;
+    U64 mReferenceIndex;
+    U64 mCaptureIndex;
+};
+
+// Lines up two sequences of packet hashes, the reference and the capture.
+//
+// Runs the two sequences have in common at either end are matched first. In between, hashes that
+// occur exactly once in both are matched in the longest order they agree on (patience diff), and
+// the stretches between those anchors are worked on the same way. A stretch with no anchors is
+// aligned with Myers' O(ND) longest common subsequence. The result is every element of both in
+// order, as the same, removed from the reference or inserted in the capture.
+class MiSpiPacketDiff
+{
+  public:
+    static void Diff( const std::vector<U64>& reference, const std::vector<U64>& capture, std::vector<MiSpiDiffEdit>& edits );
+
+  protected:
+    struct Range
+    {
+        U64 mReferenceStart;
+        U64 mReferenceEnd;
+        U64 mCaptureStart;
+        U64 mCaptureEnd;
+        bool mAnchor;
+    };
+
+    static void FindAnchors( const std::vector<U64>& reference, const std::vector<U64>& capture, const Range& range,
+                             std::vector<Range>& anchors );
+    static void Myers( const std::vector<U64>& reference, const std::vector<U64>& capture, const Range& range,
+                       std::vector<MiSpiDiffEdit>& edits );
+    static void Replace( const Range& range, std::vector<MiSpiDiffEdit>& edits );
+    static void AddEdit( std::vector<MiSpiDiffEdit>& edits, MiSpiDiffOp op, U64 reference_index, U64 capture_index );
+};
+
+#endif // MISPI_PACKET_DIFF
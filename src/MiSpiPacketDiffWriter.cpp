@@ -0,0 +1,287 @@
+#include "MiSpiPacketDiffWriter.h"
+#include "MiSpiPacketDiff.h"
+#include "MiSpiPacketStreamReader.h"
+
+#include <AnalyzerHelpers.h>
+#include <sstream>
+
+#define MISPI_DIFF_NONE ( ~0ULL )
+
+// Record type and direction, a removed entry is only shown as changed into an inserted one with the same key
+#define MISPI_DIFF_KEY_COUNT ( 4 * 3 )
+
+MiSpiPacketDiffWriter::MiSpiPacketDiffWriter( const char* reference_file, DisplayBase display_base, U32 bits_per_word, U64 sample_rate )
+    : mReferenceFile( reference_file ), mDisplayBase( display_base ), mBitsPerWord( bits_per_word ), mSampleRate( sample_rate )
+{
+}
+
+MiSpiPacketDiffWriter::~MiSpiPacketDiffWriter()
+{
+}
+
+void MiSpiPacketDiffWriter::Close()
+{
+    if( mFile == NULL )
+        return;
+
+    std::string error;
+    if( LoadReference( error ) )
+    {
+        WriteReport();
+    }
+    else
+    {
+        Append( error + "\n" );
+    }
+
+    MiSpiExportWriter::Close();
+}
+
+void MiSpiPacketDiffWriter::WriteLine( MiSpiDirection direction, const std::vector<U64>& packet, U64 repeats, U64 start_sample,
+                                       U64 /*end_sample*/ )
+{
+    mCapture.Add( MiSpiStreamLine, direction, repeats, start_sample, packet );
+}
+
+void MiSpiPacketDiffWriter::WriteSync( U64 start_sample, U64 /*end_sample*/ )
+{
+    mCapture.Add( MiSpiStreamSync, MiSpiDirUnknown, 1, start_sample, std::vector<U64>() );
+}
+
+void MiSpiPacketDiffWriter::WriteError( U64 start_sample, U64 /*end_sample*/ )
+{
+    mCapture.Add( MiSpiStreamError, MiSpiDirUnknown, 1, start_sample, std::vector<U64>() );
+}
+
+bool MiSpiPacketDiffWriter::LoadReference( std::string& error )
+{
+    MiSpiPacketStreamReader reader;
+    if( reader.Open( mReferenceFile.c_str() ) == false )
+    {
+        error = std::string( reader.GetError() ) + " '" + mReferenceFile + "'";
+        return false;
+    }
+    if( reader.GetBitsPerWord() != mBitsPerWord )
+    {
+        std::stringstream ss;
+        ss << "Reference stream: it has " << reader.GetBitsPerWord() << " bits per word, the analyzer is set to " << mBitsPerWord;
+        error = ss.str();
+        return false;
+    }
+    if( reader.GetSampleRate() != mSampleRate )
+    {
+        std::stringstream ss;
+        ss << "Reference stream: it was captured at " << reader.GetSampleRate() << " samples per second, this capture at " << mSampleRate;
+        error = ss.str();
+        return false;
+    }
+
+    MiSpiPacketStreamRecord record;
+    while( reader.Read( record ) )
+    {
+        mReference.Add( record.mType, record.mDirection, record.mRepeats, record.mStartingSampleInclusive, record.mWords );
+    }
+    error = reader.GetError();
+    return error.empty();
+}
+
+void MiSpiPacketDiffWriter::WriteReport()
+{
+    std::vector<MiSpiDiffEdit> edits;
+    MiSpiPacketDiff::Diff( mReference.mHashes, mCapture.mHashes, edits );
+
+    // Changed entries pair the removed and inserted ones of a stretch in order, by key
+    std::vector<U64> partner( edits.size(), MISPI_DIFF_NONE );
+    U64 counts[ 4 ] = { 0, 0, 0, 0 }; // changed, removed, inserted, repeats
+    U64 first_divergence = MISPI_DIFF_NONE;
+    for( size_t i = 0; i < edits.size(); )
+    {
+        if( edits[ i ].mOp == MiSpiDiffSame )
+        {
+            if( mReference.mRepeats[ edits[ i ].mReferenceIndex ] != mCapture.mRepeats[ edits[ i ].mCaptureIndex ] )
+            {
+                counts[ 3 ]++;
+                if( first_divergence == MISPI_DIFF_NONE )
+                    first_divergence = i;
+            }
+            i++;
+            continue;
+        }
+
+        if( first_divergence == MISPI_DIFF_NONE )
+            first_divergence = i;
+        size_t end = i;
+        std::vector<size_t> inserted[ MISPI_DIFF_KEY_COUNT ];
+        size_t next_inserted[ MISPI_DIFF_KEY_COUNT ] = {};
+        while( end < edits.size() && edits[ end ].mOp != MiSpiDiffSame )
+        {
+            if( edits[ end ].mOp == MiSpiDiffInserted )
+                inserted[ mCapture.GetKey( edits[ end ].mCaptureIndex ) ].push_back( end );
+            end++;
+        }
+        for( size_t e = i; e < end; e++ )
+        {
+            if( edits[ e ].mOp != MiSpiDiffRemoved )
+                continue;
+            U64 key = mReference.GetKey( edits[ e ].mReferenceIndex );
+            if( next_inserted[ key ] < inserted[ key ].size() )
+            {
+                size_t other = inserted[ key ][ next_inserted[ key ]++ ];
+                partner[ e ] = other;
+                partner[ other ] = e;
+                counts[ 0 ]++;
+            }
+            else
+            {
+                counts[ 1 ]++;
+            }
+        }
+        for( size_t e = i; e < end; e++ )
+        {
+            if( edits[ e ].mOp == MiSpiDiffInserted && partner[ e ] == MISPI_DIFF_NONE )
+                counts[ 2 ]++;
+        }
+        i = end;
+    }
+
+    std::stringstream ss;
+    ss << "Reference," << mReferenceFile << std::endl;
+    ss << "Reference Entries," << mReference.mHashes.size() << std::endl;
+    ss << "Capture Entries," << mCapture.mHashes.size() << std::endl;
+    ss << "Changed," << counts[ 0 ] << std::endl;
+    ss << "Removed," << counts[ 1 ] << std::endl;
+    ss << "Inserted," << counts[ 2 ] << std::endl;
+    ss << "Repetitions Differ," << counts[ 3 ] << std::endl;
+    ss << "First Divergence,";
+    if( first_divergence == MISPI_DIFF_NONE )
+    {
+        ss << "None" << std::endl;
+    }
+    else
+    {
+        // Where each side was when they stopped agreeing, the end if it had run out
+        const MiSpiDiffEdit& edit = edits[ first_divergence ];
+        ss << "Reference Sample,";
+        if( edit.mReferenceIndex < mReference.mStarts.size() )
+            ss << mReference.mStarts[ edit.mReferenceIndex ];
+        ss << ",Capture Sample,";
+        if( edit.mCaptureIndex < mCapture.mStarts.size() )
+            ss << mCapture.mStarts[ edit.mCaptureIndex ];
+        ss << std::endl;
+    }
+    ss << std::endl;
+    ss << "Difference,Direction,Reference Repetitions,Reference Start Sample,Capture Repetitions,Capture Start Sample,Reference Data,"
+          "Capture Data"
+       << std::endl;
+    Append( ss.str() );
+
+    for( size_t i = 0; i < edits.size(); i++ )
+    {
+        const MiSpiDiffEdit& edit = edits[ i ];
+        if( edit.mOp == MiSpiDiffSame )
+        {
+            if( mReference.mRepeats[ edit.mReferenceIndex ] != mCapture.mRepeats[ edit.mCaptureIndex ] )
+                WriteRow( "Repetitions", edit.mReferenceIndex, edit.mCaptureIndex );
+        }
+        else if( edit.mOp == MiSpiDiffRemoved )
+        {
+            if( partner[ i ] != MISPI_DIFF_NONE )
+                WriteRow( "Changed", edit.mReferenceIndex, edits[ partner[ i ] ].mCaptureIndex );
+            else
+                WriteRow( "Removed", edit.mReferenceIndex, MISPI_DIFF_NONE );
+        }
+        else if( partner[ i ] == MISPI_DIFF_NONE )
+        {
+            WriteRow( "Inserted", MISPI_DIFF_NONE, edit.mCaptureIndex );
+        }
+    }
+}
+
+void MiSpiPacketDiffWriter::WriteRow( const char* difference, U64 reference_index, U64 capture_index )
+{
+    std::string text( difference );
+    text += ",";
+    const PacketList& list = ( reference_index != MISPI_DIFF_NONE ) ? mReference : mCapture;
+    U64 index = ( reference_index != MISPI_DIFF_NONE ) ? reference_index : capture_index;
+    if( list.mTypes[ index ] == MiSpiStreamSync )
+        text += "Sync";
+    else if( list.mTypes[ index ] == MiSpiStreamError )
+        text += "Error";
+    else
+        text += ( list.mDirections[ index ] == MiSpiDirMosi ) ? "MOSI" : "MISO";
+
+    AppendEntry( text, mReference, reference_index, false );
+    AppendEntry( text, mCapture, capture_index, false );
+    AppendEntry( text, mReference, reference_index, true );
+    AppendEntry( text, mCapture, capture_index, true );
+    text += "\n";
+
+    Append( text );
+    FlushIfFull();
+}
+
+// ",repetitions,start sample" or ",data words", empty fields for the side it's not on
+void MiSpiPacketDiffWriter::AppendEntry( std::string& text, const PacketList& list, U64 index, bool data )
+{
+    if( !data )
+    {
+        text += ",";
+        if( index != MISPI_DIFF_NONE )
+        {
+            std::stringstream ss;
+            ss << list.mRepeats[ index ] << "," << list.mStarts[ index ];
+            text += ss.str();
+        }
+        else
+        {
+            text += ",";
+        }
+        return;
+    }
+
+    text += ",";
+    if( index == MISPI_DIFF_NONE )
+        return;
+    for( U64 w = list.mWordStarts[ index ]; w < list.mWordStarts[ index + 1 ]; w++ )
+    {
+        char data_str[ 128 ] = "";
+        AnalyzerHelpers::GetNumberString( list.mWords[ w ], mDisplayBase, mBitsPerWord, data_str, 128 );
+        if( w > list.mWordStarts[ index ] )
+            text += " ";
+        text += data_str;
+    }
+}
+
+// FNV-1a over the type, direction and words, the repetition count is left out
+void MiSpiPacketDiffWriter::PacketList::Add( MiSpiPacketStreamRecordType type, MiSpiDirection direction, U64 repeats, U64 start_sample,
+                                             const std::vector<U64>& words )
+{
+    U64 hash = 0xcbf29ce484222325ULL;
+    U64 values[ 3 ] = { ( U64 )type, ( U64 )direction, words.size() };
+    for( U32 i = 0; i < 3; i++ )
+    {
+        hash = ( hash ^ values[ i ] ) * 0x100000001b3ULL;
+    }
+    for( U64 i = 0; i < words.size(); i++ )
+    {
+        for( U32 b = 0; b < 64; b += 8 )
+        {
+            hash = ( hash ^ ( ( words[ i ] >> b ) & 0xFF ) ) * 0x100000001b3ULL;
+        }
+    }
+
+    if( mWordStarts.empty() )
+        mWordStarts.push_back( 0 );
+    mHashes.push_back( hash );
+    mTypes.push_back( type );
+    mDirections.push_back( direction );
+    mRepeats.push_back( repeats );
+    mStarts.push_back( start_sample );
+    mWords.insert( mWords.end(), words.begin(), words.end() );
+    mWordStarts.push_back( mWords.size() );
+}
+
+U64 MiSpiPacketDiffWriter::PacketList::GetKey( U64 index ) const
+{
+    return mTypes[ index ] * 3 + mDirections[ index ];
+}
@@ -0,0 +1,55 @@
+#ifndef MISPI_PACKET_DIFF_WRITER
+#define MISPI_PACKET_DIFF_WRITER
+
+#include <AnalyzerTypes.h>
+#include "MiSpiExportWriter.h"
+#include "MiSpiPacketStreamWriter.h"
+#include <string>
+#include <vector>
+
+// Compares the export with a packet stream written from another capture, and on Close writes a
+// CSV report of where they differ.
+//
+// Both sides are the deduplicated lines of the CSV export plus syncs and errors, each reduced to
+// a hash of its type, direction and words, so the repetition count doesn't affect how they line up.
+// Lines that line up but were repeated a different number of times are reported separately.
+class MiSpiPacketDiffWriter : public MiSpiExportWriter
+{
+  public:
+    MiSpiPacketDiffWriter( const char* reference_file, DisplayBase display_base, U32 bits_per_word, U64 sample_rate );
+    virtual ~MiSpiPacketDiffWriter();
+
+    virtual void Close();
+    virtual void WriteLine( MiSpiDirection direction, const std::vector<U64>& packet, U64 repeats, U64 start_sample, U64 end_sample );
+    virtual void WriteSync( U64 start_sample, U64 end_sample );
+    virtual void WriteError( U64 start_sample, U64 end_sample );
+
+  protected:
+    struct PacketList
+    {
+        std::vector<U64> mHashes;
+        std::vector<U8> mTypes;
+        std::vector<U8> mDirections;
+        std::vector<U64> mRepeats;
+        std::vector<U64> mStarts;
+        std::vector<U64> mWordStarts;
+        std::vector<U64> mWords;
+
+        void Add( MiSpiPacketStreamRecordType type, MiSpiDirection direction, U64 repeats, U64 start_sample, const std::vector<U64>& words );
+        U64 GetKey( U64 index ) const;
+    };
+
+    bool LoadReference( std::string& error );
+    void WriteReport();
+    void WriteRow( const char* difference, U64 reference_index, U64 capture_index );
+    void AppendEntry( std::string& text, const PacketList& list, U64 index, bool data );
+
+    std::string mReferenceFile;
+    DisplayBase mDisplayBase;
+    U32 mBitsPerWord;
+    U64 mSampleRate;
+    PacketList mReference;
+    PacketList mCapture;
+};
+
+#endif // MISPI_PACKET_DIFF_WRITER
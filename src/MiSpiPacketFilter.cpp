@@ -0,0 +1,277 @@
+#include "MiSpiPacketFilter.h"
+
+#include <cctype>
+#include <cstdlib>
+#include <sstream>
+
+MiSpiPacketFilter::MiSpiPacketFilter()
+{
+}
+
+MiSpiPacketFilter::~MiSpiPacketFilter()
+{
+}
+
+bool MiSpiPacketFilter::Compile( const char* expression )
+{
+    mGroups.clear();
+    mError.clear();
+
+    if( expression == NULL )
+        return true;
+
+    // Lower case everything up front so the term parser only has to deal with one spelling
+    std::string text( expression );
+    for( size_t i = 0; i < text.size(); i++ )
+    {
+        text[ i ] = tolower( ( unsigned char )text[ i ] );
+    }
+
+    std::stringstream groups( text );
+    std::string group_text;
+    while( std::getline( groups, group_text, ',' ) )
+    {
+        std::stringstream terms( group_text );
+        std::string token;
+        std::vector<Term> group;
+        while( terms >> token )
+        {
+            Term term;
+            if( ParseTerm( token, term ) == false )
+            {
+                mGroups.clear();
+                return false;
+            }
+            group.push_back( term );
+        }
+
+        if( group.empty() )
+        {
+            mGroups.clear();
+            return Fail( group_text, "empty filter group" );
+        }
+        mGroups.push_back( group );
+    }
+
+    return true;
+}
+
+const char* MiSpiPacketFilter::GetError() const
+{
+    return mError.c_str();
+}
+
+bool MiSpiPacketFilter::IsEmpty() const
+{
+    return mGroups.empty();
+}
+
+bool MiSpiPacketFilter::Matches( MiSpiDirection direction, const std::vector<U64>& packet, U64 start_sample, U64 end_sample ) const
+{
+    if( mGroups.empty() )
+        return true;
+
+    for( size_t g = 0; g < mGroups.size(); g++ )
+    {
+        const std::vector<Term>& group = mGroups[ g ];
+        bool match = true;
+        for( size_t t = 0; t < group.size() && match; t++ )
+        {
+            match = TermMatches( group[ t ], direction, packet, start_sample, end_sample );
+        }
+        if( match )
+            return true;
+    }
+
+    return false;
+}
+
+bool MiSpiPacketFilter::ParseTerm( const std::string& token, Term& term )
+{
+    term.mIndex = 0;
+    term.mValue = 0;
+    term.mMask = ~0ULL;
+    term.mEnd = 0;
+    term.mOp = OpEqual;
+
+    // Bare direction shorthand
+    if( token == "mosi" || token == "miso" )
+    {
+        term.mKind = TermDirection;
+        term.mValue = ( token == "mosi" ) ? MiSpiDirMosi : MiSpiDirMiso;
+        return true;
+    }
+
+    // Key
+    size_t pos = 0;
+    while( pos < token.size() && isalpha( ( unsigned char )token[ pos ] ) )
+    {
+        pos++;
+    }
+    std::string key = token.substr( 0, pos );
+
+    if( key == "dir" )
+    {
+        term.mKind = TermDirection;
+    }
+    else if( key == "len" )
+    {
+        term.mKind = TermLength;
+    }
+    else if( key == "byte" || key == "word" )
+    {
+        term.mKind = TermWord;
+
+        // Word index, "[N]"
+        if( pos >= token.size() || token[ pos ] != '[' )
+            return Fail( token, "expected '[' after byte or word" );
+        const char* index_start = token.c_str() + pos + 1;
+        char* index_end = NULL;
+        term.mIndex = strtoull( index_start, &index_end, 10 );
+        if( index_end == index_start || *index_end != ']' )
+            return Fail( token, "expected a decimal index in word[N]" );
+        pos = ( index_end - token.c_str() ) + 1;
+    }
+    else if( key == "sample" )
+    {
+        term.mKind = TermSampleRange;
+    }
+    else
+    {
+        return Fail( token, "unknown term" );
+    }
+
+    // Operator
+    std::string rest = token.substr( pos );
+    if( rest.compare( 0, 2, "!=" ) == 0 )
+    {
+        term.mOp = OpNotEqual;
+        pos += 2;
+    }
+    else if( rest.compare( 0, 2, "<=" ) == 0 )
+    {
+        term.mOp = OpLessEqual;
+        pos += 2;
+    }
+    else if( rest.compare( 0, 2, ">=" ) == 0 )
+    {
+        term.mOp = OpGreaterEqual;
+        pos += 2;
+    }
+    else if( rest.compare( 0, 1, "=" ) == 0 )
+    {
+        term.mOp = OpEqual;
+        pos += 1;
+    }
+    else if( rest.compare( 0, 1, "<" ) == 0 )
+    {
+        term.mOp = OpLess;
+        pos += 1;
+    }
+    else if( rest.compare( 0, 1, ">" ) == 0 )
+    {
+        term.mOp = OpGreater;
+        pos += 1;
+    }
+    else
+    {
+        return Fail( token, "expected a comparison operator" );
+    }
+
+    if( term.mKind != TermLength && term.mOp != OpEqual && !( term.mKind == TermWord && term.mOp == OpNotEqual ) )
+        return Fail( token, "operator not supported for this term" );
+
+    // Value
+    std::string value = token.substr( pos );
+    const char* value_start = value.c_str();
+    char* value_end = NULL;
+
+    if( term.mKind == TermDirection )
+    {
+        if( value == "mosi" )
+            term.mValue = MiSpiDirMosi;
+        else if( value == "miso" )
+            term.mValue = MiSpiDirMiso;
+        else
+            return Fail( token, "direction must be mosi or miso" );
+    }
+    else if( term.mKind == TermLength )
+    {
+        term.mValue = strtoull( value_start, &value_end, 10 );
+        if( value_end == value_start || *value_end != '\0' )
+            return Fail( token, "expected a decimal length" );
+    }
+    else if( term.mKind == TermWord )
+    {
+        term.mValue = strtoull( value_start, &value_end, 16 );
+        if( value_end == value_start )
+            return Fail( token, "expected a hex value" );
+        if( *value_end == '/' )
+        {
+            const char* mask_start = value_end + 1;
+            term.mMask = strtoull( mask_start, &value_end, 16 );
+            if( value_end == mask_start )
+                return Fail( token, "expected a hex mask after '/'" );
+        }
+        if( *value_end != '\0' )
+            return Fail( token, "unexpected characters after value" );
+        term.mValue &= term.mMask;
+    }
+    else
+    {
+        term.mValue = strtoull( value_start, &value_end, 10 );
+        if( value_end == value_start || *value_end != '-' )
+            return Fail( token, "expected a sample range A-B" );
+        const char* end_start = value_end + 1;
+        term.mEnd = strtoull( end_start, &value_end, 10 );
+        if( value_end == end_start || *value_end != '\0' || term.mEnd < term.mValue )
+            return Fail( token, "expected a sample range A-B" );
+    }
+
+    return true;
+}
+
+bool MiSpiPacketFilter::Fail( const std::string& token, const char* reason )
+{
+    mError = "Export filter: " + std::string( reason ) + " in '" + token + "'";
+    return false;
+}
+
+bool MiSpiPacketFilter::Compare( U64 lhs, TermOp op, U64 rhs )
+{
+    switch( op )
+    {
+    case OpEqual:
+        return lhs == rhs;
+    case OpNotEqual:
+        return lhs != rhs;
+    case OpLess:
+        return lhs < rhs;
+    case OpLessEqual:
+        return lhs <= rhs;
+    case OpGreater:
+        return lhs > rhs;
+    case OpGreaterEqual:
+        return lhs >= rhs;
+    }
+    return false;
+}
+
+bool MiSpiPacketFilter::TermMatches( const Term& term, MiSpiDirection direction, const std::vector<U64>& packet, U64 start_sample,
+                                     U64 end_sample )
+{
+    switch( term.mKind )
+    {
+    case TermDirection:
+        return direction == ( MiSpiDirection )term.mValue;
+    case TermLength:
+        return Compare( packet.size(), term.mOp, term.mValue );
+    case TermWord:
+        if( term.mIndex >= packet.size() )
+            return false;
+        return Compare( packet[ term.mIndex ] & term.mMask, term.mOp, term.mValue );
+    case TermSampleRange:
+        return start_sample <= term.mEnd && end_sample >= term.mValue;
+    }
+    return false;
+}
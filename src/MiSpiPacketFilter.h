@@ -0,0 +1,71 @@
+#ifndef MISPI_PACKET_FILTER
+#define MISPI_PACKET_FILTER
+
+#include <AnalyzerTypes.h>
+#include "MiSpiTypes.h"
+#include <string>
+#include <vector>
+
+// Compiled form of the "Export Filter" setting.
+//
+// Terms separated by whitespace must all match, groups separated by commas are OR'ed:
+//
+//   dir=mosi | dir=miso | mosi | miso      packet direction
+//   len<op>N                               packet length in words, op is one of = != < <= > >=
+//   word[N]=HH  word[N]!=HH  word[N]=HH/MM word N of the packet (hex), optionally masked, byte[N] is the same
+//   sample=A-B                             packet overlaps samples A through B
+//
+// e.g. "mosi byte[0]=A5 len>=3, miso len=0"
+//
+// An empty expression matches everything. A packet shorter than N+1 words never matches byte[N].
+class MiSpiPacketFilter
+{
+  public:
+    MiSpiPacketFilter();
+    ~MiSpiPacketFilter();
+
+    bool Compile( const char* expression );
+    const char* GetError() const;
+    bool IsEmpty() const;
+
+    bool Matches( MiSpiDirection direction, const std::vector<U64>& packet, U64 start_sample, U64 end_sample ) const;
+
+  protected:
+    enum TermKind {
+        TermDirection,
+        TermLength,
+        TermWord,
+        TermSampleRange
+    };
+
+    enum TermOp {
+        OpEqual,
+        OpNotEqual,
+        OpLess,
+        OpLessEqual,
+        OpGreater,
+        OpGreaterEqual
+    };
+
+    struct Term
+    {
+        TermKind mKind;
+        TermOp mOp;
+        U64 mIndex;
+        U64 mValue;
+        U64 mMask;
+        U64 mEnd;
+    };
+
+    bool ParseTerm( const std::string& token, Term& term );
+    bool Fail( const std::string& token, const char* reason );
+
+    static bool Compare( U64 lhs, TermOp op, U64 rhs );
+    static bool TermMatches( const Term& term, MiSpiDirection direction, const std::vector<U64>& packet, U64 start_sample,
+                             U64 end_sample );
+
+    std::vector<std::vector<Term> > mGroups;
+    std::string mError;
+};
+
+#endif // MISPI_PACKET_FILTER
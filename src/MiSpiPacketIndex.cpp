@@ -0,0 +1,188 @@
+#include "MiSpiPacketIndex.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+
+static bool RangeStartsBefore( const MiSpiPacketRange& a, const MiSpiPacketRange& b )
+{
+    return a.mStartingSampleInclusive < b.mStartingSampleInclusive;
+}
+
+MiSpiPacketIndex::MiSpiPacketIndex()
+{
+    mMosi.mUnigrams.resize( 1 << 8 );
+    mMosi.mBigrams.resize( 1 << 16 );
+    mMiso.mUnigrams.resize( 1 << 8 );
+    mMiso.mBigrams.resize( 1 << 16 );
+}
+
+MiSpiPacketIndex::~MiSpiPacketIndex()
+{
+}
+
+void MiSpiPacketIndex::AddPacket( MiSpiDirection direction, const std::vector<U8>& payload, U64 start_sample, U64 end_sample, bool repeat )
+{
+    if( direction == MiSpiDirUnknown )
+        return;
+
+    std::lock_guard<std::mutex> lock( mMutex );
+    DirectionIndex& index = ( direction == MiSpiDirMosi ) ? mMosi : mMiso;
+
+    if( repeat && !index.mOccurrences.empty() )
+    {
+        index.mOccurrences.back().mEndingSampleInclusive = end_sample;
+        return;
+    }
+
+    Occurrence occurrence;
+    occurrence.mStartingSampleInclusive = start_sample;
+    occurrence.mEndingSampleInclusive = end_sample;
+    index.mOccurrences.push_back( occurrence );
+
+    // Repeat of the previous packet, just note where it happened
+    if( !index.mRuns.empty() )
+    {
+        Run& last = index.mRuns.back();
+        if( last.mPayloadLength == payload.size() &&
+            ( payload.empty() || memcmp( &index.mPayload[ last.mPayloadOffset ], &payload[ 0 ], payload.size() ) == 0 ) )
+        {
+            last.mOccurrences++;
+            return;
+        }
+    }
+
+    Run run;
+    run.mPayloadOffset = index.mPayload.size();
+    run.mPayloadLength = payload.size();
+    run.mFirstOccurrence = index.mOccurrences.size() - 1;
+    run.mOccurrences = 1;
+    U32 run_id = index.mRuns.size();
+    index.mRuns.push_back( run );
+    index.mPayload.insert( index.mPayload.end(), payload.begin(), payload.end() );
+
+    for( size_t i = 0; i < payload.size(); i++ )
+    {
+        Post( index.mUnigrams[ payload[ i ] ], run_id );
+        if( i + 1 < payload.size() )
+            Post( index.mBigrams[ ( payload[ i ] << 8 ) | payload[ i + 1 ] ], run_id );
+    }
+}
+
+void MiSpiPacketIndex::Find( MiSpiDirection direction, const std::vector<U8>& pattern, std::vector<MiSpiPacketRange>& matches )
+{
+    if( pattern.empty() )
+        return;
+
+    std::lock_guard<std::mutex> lock( mMutex );
+    size_t first_match = matches.size();
+
+    if( direction != MiSpiDirMiso )
+        FindInDirection( mMosi, MiSpiDirMosi, pattern, matches );
+    if( direction != MiSpiDirMosi )
+        FindInDirection( mMiso, MiSpiDirMiso, pattern, matches );
+
+    // Each direction comes out in order already, merge the two
+    if( direction == MiSpiDirUnknown )
+        std::stable_sort( matches.begin() + first_match, matches.end(), RangeStartsBefore );
+}
+
+void MiSpiPacketIndex::FindInDirection( DirectionIndex& index, MiSpiDirection direction, const std::vector<U8>& pattern,
+                                        std::vector<MiSpiPacketRange>& matches )
+{
+    // Candidates come from the rarest gram of the pattern, everything on it still needs verifying
+    const std::vector<U32>* candidates = &index.mUnigrams[ pattern[ 0 ] ];
+    if( pattern.size() >= 2 )
+    {
+        candidates = &index.mBigrams[ ( pattern[ 0 ] << 8 ) | pattern[ 1 ] ];
+        for( size_t i = 1; i + 1 < pattern.size() && !candidates->empty(); i++ )
+        {
+            const std::vector<U32>& posting = index.mBigrams[ ( pattern[ i ] << 8 ) | pattern[ i + 1 ] ];
+            if( posting.size() < candidates->size() )
+                candidates = &posting;
+        }
+    }
+
+    for( size_t c = 0; c < candidates->size(); c++ )
+    {
+        const Run& run = index.mRuns[ ( *candidates )[ c ] ];
+        if( !RunContains( index, run, pattern ) )
+            continue;
+
+        for( U64 o = 0; o < run.mOccurrences; o++ )
+        {
+            const Occurrence& occurrence = index.mOccurrences[ run.mFirstOccurrence + o ];
+            MiSpiPacketRange range;
+            range.mDirection = direction;
+            range.mStartingSampleInclusive = occurrence.mStartingSampleInclusive;
+            range.mEndingSampleInclusive = occurrence.mEndingSampleInclusive;
+            matches.push_back( range );
+        }
+    }
+}
+
+void MiSpiPacketIndex::Post( std::vector<U32>& posting, U32 run_id )
+{
+    // A gram can show up several times in one payload, only list the run once
+    if( posting.empty() || posting.back() != run_id )
+        posting.push_back( run_id );
+}
+
+bool MiSpiPacketIndex::RunContains( const DirectionIndex& index, const Run& run, const std::vector<U8>& pattern )
+{
+    if( run.mPayloadLength < pattern.size() )
+        return false;
+
+    const U8* payload = &index.mPayload[ run.mPayloadOffset ];
+    return std::search( payload, payload + run.mPayloadLength, pattern.begin(), pattern.end() ) != payload + run.mPayloadLength;
+}
+
+bool MiSpiPacketIndex::ParsePattern( const char* text, MiSpiDirection& direction, std::vector<U8>& pattern, std::string& error )
+{
+    direction = MiSpiDirUnknown;
+    pattern.clear();
+    error.clear();
+
+    std::string hex;
+    std::string word;
+    for( const char* p = text;; p++ )
+    {
+        if( *p != '\0' && !isspace( ( unsigned char )*p ) )
+        {
+            word += tolower( ( unsigned char )*p );
+            continue;
+        }
+
+        if( word == "mosi" )
+            direction = MiSpiDirMosi;
+        else if( word == "miso" )
+            direction = MiSpiDirMiso;
+        else
+            hex += word;
+        word.clear();
+
+        if( *p == '\0' )
+            break;
+    }
+
+    if( hex.compare( 0, 2, "0x" ) == 0 )
+        hex = hex.substr( 2 );
+
+    if( hex.empty() )
+    {
+        error = "Search pattern: no bytes given";
+        return false;
+    }
+    if( hex.size() % 2 != 0 || hex.find_first_not_of( "0123456789abcdef" ) != std::string::npos )
+    {
+        error = "Search pattern: expected whole hex bytes, e.g. \"mosi A5 01\"";
+        return false;
+    }
+
+    for( size_t i = 0; i < hex.size(); i += 2 )
+    {
+        pattern.push_back( ( U8 )strtoul( hex.substr( i, 2 ).c_str(), NULL, 16 ) );
+    }
+    return true;
+}
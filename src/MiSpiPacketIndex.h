@@ -0,0 +1,72 @@
+#ifndef MISPI_PACKET_INDEX
+#define MISPI_PACKET_INDEX
+
+#include <AnalyzerTypes.h>
+#include "MiSpiTypes.h"
+#include <mutex>
+#include <string>
+#include <vector>
+
+struct MiSpiPacketRange
+{
+    MiSpiDirection mDirection;
+    U64 mStartingSampleInclusive;
+    U64 mEndingSampleInclusive;
+};
+
+// Inverted index over decoded packet payloads, filled by the worker thread as packets complete.
+//
+// Consecutive identical packets in the same direction share one "run" so idle traffic doesn't
+// grow the postings. Every distinct byte and byte pair of a run's payload points back at the run,
+// so a search only has to verify the runs on the shortest posting list instead of every packet.
+class MiSpiPacketIndex
+{
+  public:
+    MiSpiPacketIndex();
+    ~MiSpiPacketIndex();
+
+    // A repeat the decoder folded into one frame stretches the previous occurrence instead of adding one
+    void AddPacket( MiSpiDirection direction, const std::vector<U8>& payload, U64 start_sample, U64 end_sample, bool repeat );
+
+    // Appends every packet containing pattern to matches, ordered by start sample.
+    // MiSpiDirUnknown searches both directions.
+    void Find( MiSpiDirection direction, const std::vector<U8>& pattern, std::vector<MiSpiPacketRange>& matches );
+
+    // Parses a search pattern such as "mosi A5 01" or "A501". The direction is optional.
+    static bool ParsePattern( const char* text, MiSpiDirection& direction, std::vector<U8>& pattern, std::string& error );
+
+  protected:
+    struct Run
+    {
+        U64 mPayloadOffset;
+        U32 mPayloadLength;
+        U64 mFirstOccurrence;
+        U64 mOccurrences;
+    };
+
+    struct Occurrence
+    {
+        U64 mStartingSampleInclusive;
+        U64 mEndingSampleInclusive;
+    };
+
+    struct DirectionIndex
+    {
+        std::vector<U8> mPayload;
+        std::vector<Run> mRuns;
+        std::vector<Occurrence> mOccurrences;
+        std::vector<std::vector<U32> > mUnigrams;
+        std::vector<std::vector<U32> > mBigrams;
+    };
+
+    void FindInDirection( DirectionIndex& index, MiSpiDirection direction, const std::vector<U8>& pattern,
+                          std::vector<MiSpiPacketRange>& matches );
+    static void Post( std::vector<U32>& posting, U32 run_id );
+    static bool RunContains( const DirectionIndex& index, const Run& run, const std::vector<U8>& pattern );
+
+    DirectionIndex mMosi;
+    DirectionIndex mMiso;
+    std::mutex mMutex;
+};
+
+#endif // MISPI_PACKET_INDEX
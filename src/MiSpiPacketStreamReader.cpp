@@ -0,0 +1,158 @@
+#include "MiSpiPacketStreamReader.h"
+#include "MiSpiVarint.h"
+
+#include <cstring>
+
+#define MISPI_STREAM_READ_SIZE ( 1024 * 1024 )
+
+// Longest record the reader looks for the end of before taking the file as damaged
+#define MISPI_STREAM_RECORD_LIMIT ( 16 * 1024 * 1024 )
+
+MiSpiPacketStreamReader::MiSpiPacketStreamReader() : mOffset( 0 ), mBitsPerWord( 0 ), mSampleRate( 0 ), mLastSample( 0 )
+{
+}
+
+bool MiSpiPacketStreamReader::Open( const char* file )
+{
+    mFile.close();
+    mFile.clear();
+    mData.clear();
+    mOffset = 0;
+    mLastSample = 0;
+    mError.clear();
+
+    mFile.open( file, std::ios::in | std::ios::binary );
+    if( !mFile )
+        return Fail( "can't open the file" );
+
+    // The magic and two varints of at most ten bytes each
+    size_t magic_length = strlen( MISPI_PACKET_STREAM_MAGIC );
+    while( mData.size() < magic_length + 20 && ReadChunk() )
+    {
+    }
+    if( mData.size() < magic_length || memcmp( &mData[ 0 ], MISPI_PACKET_STREAM_MAGIC, magic_length ) != 0 )
+        return Fail( "not a packet stream file" );
+
+    const U8* data = &mData[ 0 ] + magic_length;
+    const U8* end = &mData[ 0 ] + mData.size();
+    U64 bits_per_word;
+    if( !MiSpiReadVarint( data, end, bits_per_word ) || !MiSpiReadVarint( data, end, mSampleRate ) )
+        return Fail( "the header is cut short" );
+    mBitsPerWord = bits_per_word;
+    mOffset = data - &mData[ 0 ];
+    return true;
+}
+
+const char* MiSpiPacketStreamReader::GetError() const
+{
+    return mError.c_str();
+}
+
+U32 MiSpiPacketStreamReader::GetBitsPerWord() const
+{
+    return mBitsPerWord;
+}
+
+U64 MiSpiPacketStreamReader::GetSampleRate() const
+{
+    return mSampleRate;
+}
+
+bool MiSpiPacketStreamReader::Read( MiSpiPacketStreamRecord& record )
+{
+    const char* cut_short = NULL;
+    while( mError.empty() )
+    {
+        if( mOffset < mData.size() )
+        {
+            const U8* begin = &mData[ 0 ];
+            const U8* data = begin + mOffset;
+            if( Parse( data, begin + mData.size(), record, cut_short ) )
+            {
+                mOffset = data - begin;
+                return true;
+            }
+
+            // No record is that long, the file is damaged here
+            if( !mError.empty() || mData.size() - mOffset > MISPI_STREAM_RECORD_LIMIT )
+                break;
+        }
+
+        if( !ReadChunk() )
+            break;
+    }
+
+    // Running out of file part way through a record
+    if( cut_short != NULL && mError.empty() )
+        Fail( cut_short );
+    return false;
+}
+
+// False with cut_short set if the record runs past end, more of the file may finish it
+bool MiSpiPacketStreamReader::Parse( const U8*& data, const U8* end, MiSpiPacketStreamRecord& record, const char*& cut_short )
+{
+    U8 type = *data++;
+    U64 direction = MiSpiDirUnknown;
+    U64 delta;
+    U64 span;
+    record.mRepeats = 1;
+    record.mWords.clear();
+
+    if( type == MiSpiStreamLine )
+    {
+        U64 word_count;
+        cut_short = "a packet record is cut short";
+        if( !MiSpiReadVarint( data, end, direction ) )
+            return false;
+        if( direction > MiSpiDirMosi )
+            return Fail( "a packet record has an unknown direction" );
+        if( !MiSpiReadVarint( data, end, record.mRepeats ) || !MiSpiReadVarint( data, end, delta ) || !MiSpiReadVarint( data, end, span ) ||
+            !MiSpiReadVarint( data, end, word_count ) || word_count > U64( end - data ) )
+            return false;
+        record.mWords.resize( word_count );
+        for( U64 i = 0; i < word_count; i++ )
+        {
+            if( !MiSpiReadVarint( data, end, record.mWords[ i ] ) )
+                return false;
+        }
+    }
+    else if( type == MiSpiStreamSync || type == MiSpiStreamError )
+    {
+        cut_short = "a sync or error record is cut short";
+        if( !MiSpiReadVarint( data, end, delta ) || !MiSpiReadVarint( data, end, span ) )
+            return false;
+    }
+    else
+    {
+        return Fail( "unknown record type" );
+    }
+
+    record.mType = ( MiSpiPacketStreamRecordType )type;
+    record.mDirection = ( MiSpiDirection )direction;
+    record.mStartingSampleInclusive = mLastSample + MiSpiUnZigZag( delta );
+    record.mEndingSampleInclusive = record.mStartingSampleInclusive + span;
+    mLastSample = record.mStartingSampleInclusive;
+    return true;
+}
+
+bool MiSpiPacketStreamReader::ReadChunk()
+{
+    if( !mFile.is_open() )
+        return false;
+
+    // Only what hasn't been parsed yet is still needed
+    mData.erase( mData.begin(), mData.begin() + mOffset );
+    mOffset = 0;
+
+    size_t size = mData.size();
+    mData.resize( size + MISPI_STREAM_READ_SIZE );
+    mFile.read( ( char* )&mData[ size ], MISPI_STREAM_READ_SIZE );
+    mData.resize( size + ( size_t )mFile.gcount() );
+    return mData.size() > size;
+}
+
+bool MiSpiPacketStreamReader::Fail( const char* reason )
+{
+    mError = "Reference stream: " + std::string( reason );
+    return false;
+}
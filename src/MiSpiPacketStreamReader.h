@@ -0,0 +1,51 @@
+#ifndef MISPI_PACKET_STREAM_READER
+#define MISPI_PACKET_STREAM_READER
+
+#include <AnalyzerTypes.h>
+#include "MiSpiPacketStreamWriter.h"
+#include "MiSpiTypes.h"
+#include <fstream>
+#include <string>
+#include <vector>
+
+struct MiSpiPacketStreamRecord
+{
+    MiSpiPacketStreamRecordType mType;
+    MiSpiDirection mDirection;
+    U64 mRepeats;
+    U64 mStartingSampleInclusive;
+    U64 mEndingSampleInclusive;
+    std::vector<U64> mWords;
+};
+
+// Reads back a file written by MiSpiPacketStreamWriter, a record at a time. The file is read a chunk at a time,
+// so it never has to fit in memory.
+class MiSpiPacketStreamReader
+{
+  public:
+    MiSpiPacketStreamReader();
+
+    bool Open( const char* file );
+    const char* GetError() const;
+    U32 GetBitsPerWord() const;
+    U64 GetSampleRate() const;
+
+    // False at the end, or if the file is damaged, in which case GetError says so
+    bool Read( MiSpiPacketStreamRecord& record );
+
+  protected:
+    bool Parse( const U8*& data, const U8* end, MiSpiPacketStreamRecord& record, const char*& cut_short );
+    bool ReadChunk();
+    bool Fail( const char* reason );
+
+    // What's been read of the file and not parsed yet starts at mOffset in mData
+    std::ifstream mFile;
+    std::vector<U8> mData;
+    size_t mOffset;
+    U32 mBitsPerWord;
+    U64 mSampleRate;
+    U64 mLastSample;
+    std::string mError;
+};
+
+#endif // MISPI_PACKET_STREAM_READER
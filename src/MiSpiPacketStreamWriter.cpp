@@ -0,0 +1,58 @@
+#include "MiSpiPacketStreamWriter.h"
+#include "MiSpiVarint.h"
+
+MiSpiPacketStreamWriter::MiSpiPacketStreamWriter( U32 bits_per_word, U64 sample_rate )
+    : mBitsPerWord( bits_per_word ), mSampleRate( sample_rate ), mLastSample( 0 )
+{
+}
+
+MiSpiPacketStreamWriter::~MiSpiPacketStreamWriter()
+{
+}
+
+void MiSpiPacketStreamWriter::Open( const char* file )
+{
+    MiSpiExportWriter::Open( file );
+
+    Append( std::string( MISPI_PACKET_STREAM_MAGIC ) );
+    MiSpiAppendVarint( mBuffer, mBitsPerWord );
+    MiSpiAppendVarint( mBuffer, mSampleRate );
+    mLastSample = 0;
+}
+
+void MiSpiPacketStreamWriter::WriteLine( MiSpiDirection direction, const std::vector<U64>& packet, U64 repeats, U64 start_sample,
+                                         U64 end_sample )
+{
+    mBuffer.push_back( MiSpiStreamLine );
+    MiSpiAppendVarint( mBuffer, direction );
+    MiSpiAppendVarint( mBuffer, repeats );
+    AppendSpan( start_sample, end_sample );
+    MiSpiAppendVarint( mBuffer, packet.size() );
+    for( U64 i = 0; i < packet.size(); i++ )
+    {
+        MiSpiAppendVarint( mBuffer, packet[ i ] );
+    }
+    FlushIfFull();
+}
+
+void MiSpiPacketStreamWriter::WriteSync( U64 start_sample, U64 end_sample )
+{
+    mBuffer.push_back( MiSpiStreamSync );
+    AppendSpan( start_sample, end_sample );
+    FlushIfFull();
+}
+
+void MiSpiPacketStreamWriter::WriteError( U64 start_sample, U64 end_sample )
+{
+    mBuffer.push_back( MiSpiStreamError );
+    AppendSpan( start_sample, end_sample );
+    FlushIfFull();
+}
+
+// Lines are written when they end, so starts don't always go up, hence the zigzag
+void MiSpiPacketStreamWriter::AppendSpan( U64 start_sample, U64 end_sample )
+{
+    MiSpiAppendVarint( mBuffer, MiSpiZigZag( S64( start_sample - mLastSample ) ) );
+    MiSpiAppendVarint( mBuffer, end_sample - start_sample );
+    mLastSample = start_sample;
+}
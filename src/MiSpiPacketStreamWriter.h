@@ -0,0 +1,41 @@
+#ifndef MISPI_PACKET_STREAM_WRITER
+#define MISPI_PACKET_STREAM_WRITER
+
+#include <AnalyzerTypes.h>
+#include "MiSpiExportWriter.h"
+
+#define MISPI_PACKET_STREAM_MAGIC "MISPIPS1"
+
+enum MiSpiPacketStreamRecordType {
+  MiSpiStreamLine = 1,
+  MiSpiStreamSync,
+  MiSpiStreamError
+};
+
+// The deduplicated packets of an export in a compact binary form, for tools and for comparing
+// against later captures.
+//
+// After the magic come the bits per word and the sample rate as varints. Each record is its type
+// byte, then for a line the direction, repetition count, start sample, sample span, word count and
+// words, and for a sync or error the start sample and span. Start samples are zigzag varint
+// deltas from the previous record's start, everything else is a plain varint.
+class MiSpiPacketStreamWriter : public MiSpiExportWriter
+{
+  public:
+    MiSpiPacketStreamWriter( U32 bits_per_word, U64 sample_rate );
+    virtual ~MiSpiPacketStreamWriter();
+
+    virtual void Open( const char* file );
+    virtual void WriteLine( MiSpiDirection direction, const std::vector<U64>& packet, U64 repeats, U64 start_sample, U64 end_sample );
+    virtual void WriteSync( U64 start_sample, U64 end_sample );
+    virtual void WriteError( U64 start_sample, U64 end_sample );
+
+  protected:
+    void AppendSpan( U64 start_sample, U64 end_sample );
+
+    U32 mBitsPerWord;
+    U64 mSampleRate;
+    U64 mLastSample;
+};
+
+#endif // MISPI_PACKET_STREAM_WRITER
@@ -0,0 +1,142 @@
+#include "MiSpiPcapngWriter.h"
+
+#include <cstring>
+#include <sstream>
+
+// Block and option codes from the pcapng specification
+#define PCAPNG_SECTION_HEADER_BLOCK 0x0A0D0D0A
+#define PCAPNG_INTERFACE_DESCRIPTION_BLOCK 0x00000001
+#define PCAPNG_ENHANCED_PACKET_BLOCK 0x00000006
+#define PCAPNG_BYTE_ORDER_MAGIC 0x1A2B3C4D
+#define PCAPNG_OPT_ENDOFOPT 0
+#define PCAPNG_OPT_COMMENT 1
+#define PCAPNG_IF_NAME 2
+#define PCAPNG_IF_TSRESOL 9
+#define PCAPNG_EPB_FLAGS 2
+#define PCAPNG_EPB_INBOUND 0x1
+#define PCAPNG_EPB_OUTBOUND 0x2
+
+// LINKTYPE_USER0, there's no registered link type for MI-SPI
+#define PCAPNG_LINKTYPE 147
+
+MiSpiPcapngWriter::MiSpiPcapngWriter( U32 bits_per_word, U64 sample_rate ) : mBitsPerWord( bits_per_word )
+{
+    mTimeBase.Init( sample_rate, 0, MiSpiTimeNanoseconds );
+}
+
+MiSpiPcapngWriter::~MiSpiPcapngWriter()
+{
+}
+
+void MiSpiPcapngWriter::Open( const char* file )
+{
+    MiSpiExportWriter::Open( file );
+
+    // Section header, no options
+    Append32( PCAPNG_SECTION_HEADER_BLOCK );
+    Append32( 28 );
+    Append32( PCAPNG_BYTE_ORDER_MAGIC );
+    Append16( 1 ); // major version
+    Append16( 0 ); // minor version
+    Append32( 0xFFFFFFFF ); // section length not specified
+    Append32( 0xFFFFFFFF );
+    Append32( 28 );
+
+    // Single interface with nanosecond timestamps
+    const char name[] = "MI-SPI";
+    U8 tsresol = 9;
+    U32 length = 20 + 8 + 4 + ( ( sizeof( name ) - 1 + 3 ) & ~3 ) + 4;
+    Append32( PCAPNG_INTERFACE_DESCRIPTION_BLOCK );
+    Append32( length );
+    Append16( PCAPNG_LINKTYPE );
+    Append16( 0 );
+    Append32( 0 ); // no snap length
+    AppendOption( PCAPNG_IF_TSRESOL, &tsresol, 1 );
+    AppendOption( PCAPNG_IF_NAME, ( const U8* )name, sizeof( name ) - 1 );
+    AppendOption( PCAPNG_OPT_ENDOFOPT, NULL, 0 );
+    Append32( length );
+}
+
+void MiSpiPcapngWriter::WritePacket( MiSpiDirection direction, const std::vector<U64>& packet, U64 start_sample, U64 /*end_sample*/ )
+{
+    WriteBlock( direction, packet, start_sample, NULL );
+}
+
+// The decoder only kept the count, write the repeated packet once and say so
+void MiSpiPcapngWriter::WriteRepeat( MiSpiDirection direction, const std::vector<U64>& packet, U64 count, U64 start_sample,
+                                     U64 end_sample )
+{
+    std::stringstream comment;
+    comment << "Repeated " << count << " times, samples " << start_sample << " to " << end_sample;
+    WriteBlock( direction, packet, start_sample, comment.str().c_str() );
+}
+
+void MiSpiPcapngWriter::WriteBlock( MiSpiDirection direction, const std::vector<U64>& packet, U64 start_sample, const char* comment )
+{
+    mPayload.clear();
+    for( U64 w = 0; w < packet.size(); w++ )
+    {
+        MiSpiAppendWordBytes( mPayload, packet[ w ], mBitsPerWord );
+    }
+    U64 timestamp_ns = mTimeBase.GetNs( start_sample );
+
+    U32 data_length = mPayload.size();
+    U32 comment_length = ( comment != NULL ) ? strlen( comment ) : 0;
+    U32 length = 28 + ( ( data_length + 3 ) & ~3 ) + 8 + 4 + 4;
+    if( comment_length > 0 )
+        length += 4 + ( ( comment_length + 3 ) & ~3 );
+
+    U32 flags = ( direction == MiSpiDirMosi ) ? PCAPNG_EPB_OUTBOUND : PCAPNG_EPB_INBOUND;
+
+    Append32( PCAPNG_ENHANCED_PACKET_BLOCK );
+    Append32( length );
+    Append32( 0 ); // interface
+    Append32( timestamp_ns >> 32 );
+    Append32( timestamp_ns & 0xFFFFFFFF );
+    Append32( data_length );
+    Append32( data_length );
+    if( data_length > 0 )
+        Append( &mPayload[ 0 ], data_length );
+    Pad();
+    AppendOption( PCAPNG_EPB_FLAGS, ( const U8* )&flags, 4 );
+    if( comment_length > 0 )
+        AppendOption( PCAPNG_OPT_COMMENT, ( const U8* )comment, comment_length );
+    AppendOption( PCAPNG_OPT_ENDOFOPT, NULL, 0 );
+    Append32( length );
+
+    FlushIfFull();
+}
+
+void MiSpiPcapngWriter::Append8( U8 value )
+{
+    mBuffer.push_back( value );
+}
+
+// Everything is written in host byte order, readers go by the byte order magic
+void MiSpiPcapngWriter::Append16( U16 value )
+{
+    Append( ( const U8* )&value, 2 );
+}
+
+void MiSpiPcapngWriter::Append32( U32 value )
+{
+    Append( ( const U8* )&value, 4 );
+}
+
+void MiSpiPcapngWriter::AppendOption( U16 code, const U8* data, U16 length )
+{
+    Append16( code );
+    Append16( length );
+    if( length > 0 )
+        Append( data, length );
+    Pad();
+}
+
+// Blocks and option values are padded to 32 bits
+void MiSpiPcapngWriter::Pad()
+{
+    while( mBuffer.size() % 4 != 0 )
+    {
+        Append8( 0 );
+    }
+}
@@ -0,0 +1,38 @@
+#ifndef MISPI_PCAPNG_WRITER
+#define MISPI_PCAPNG_WRITER
+
+#include <AnalyzerTypes.h>
+#include "MiSpiExportWriter.h"
+#include "MiSpiTimeBase.h"
+#include "MiSpiTypes.h"
+#include <vector>
+
+// Streams decoded packets to a pcapng file, one enhanced packet block per packet.
+//
+// Timestamps are nanoseconds since the start of the capture, the direction goes into the
+// inbound/outbound bits of epb_flags with MOSI as outbound. A run of repeats the decoder folded is
+// written once, with a comment giving the count and sample range.
+class MiSpiPcapngWriter : public MiSpiExportWriter
+{
+  public:
+    MiSpiPcapngWriter( U32 bits_per_word, U64 sample_rate );
+    virtual ~MiSpiPcapngWriter();
+
+    virtual void Open( const char* file );
+    virtual void WritePacket( MiSpiDirection direction, const std::vector<U64>& packet, U64 start_sample, U64 end_sample );
+    virtual void WriteRepeat( MiSpiDirection direction, const std::vector<U64>& packet, U64 count, U64 start_sample, U64 end_sample );
+
+  protected:
+    void WriteBlock( MiSpiDirection direction, const std::vector<U64>& packet, U64 start_sample, const char* comment );
+    void Append8( U8 value );
+    void Append16( U16 value );
+    void Append32( U32 value );
+    void AppendOption( U16 code, const U8* data, U16 length );
+    void Pad();
+
+    U32 mBitsPerWord;
+    MiSpiTimeBase mTimeBase;
+    std::vector<U8> mPayload;
+};
+
+#endif // MISPI_PCAPNG_WRITER
@@ -0,0 +1,109 @@
+#include "MiSpiPulseTimeline.h"
+#include "MiSpiVarint.h"
+
+#define MISPI_TIMELINE_CHUNK_SIZE ( 1024 * 1024 )
+
+// Two varints of at most ten bytes each
+#define MISPI_TIMELINE_MAX_PULSE_SIZE 20
+
+MiSpiPulseTimeline::MiSpiPulseTimeline()
+    : mDataChannel( UNDEFINED_CHANNEL ),
+      mClockChannel( UNDEFINED_CHANNEL ),
+      mSampleRate( 0 ),
+      mEnd( 0 ),
+      mPulseCount( 0 ),
+      mReading( false ),
+      mReadChunk( 0 ),
+      mReadOffset( 0 ),
+      mReadEnd( 0 )
+{
+}
+
+void MiSpiPulseTimeline::Prepare( const Channel& data, const Channel& clock, U64 sample_rate )
+{
+    if( data != mDataChannel || clock != mClockChannel || sample_rate != mSampleRate )
+    {
+        Clear();
+        mDataChannel = data;
+        mClockChannel = clock;
+        mSampleRate = sample_rate;
+    }
+
+    mReading = true;
+    mReadChunk = 0;
+    mReadOffset = 0;
+    mReadEnd = 0;
+}
+
+void MiSpiPulseTimeline::Clear()
+{
+    std::vector<std::vector<U8> >().swap( mChunks );
+    mEnd = 0;
+    mPulseCount = 0;
+    mReading = false;
+    mReadChunk = 0;
+    mReadOffset = 0;
+    mReadEnd = 0;
+}
+
+bool MiSpiPulseTimeline::HasNext()
+{
+    if( !mReading )
+        return false;
+
+    if( mReadChunk < mChunks.size() && mReadOffset == mChunks[ mReadChunk ].size() )
+    {
+        mReadChunk++;
+        mReadOffset = 0;
+    }
+    if( mReadChunk >= mChunks.size() )
+        mReading = false;
+    return mReading;
+}
+
+bool MiSpiPulseTimeline::Read( U64& start, U64& end, U64& bit )
+{
+    if( !HasNext() )
+        return false;
+
+    const std::vector<U8>& chunk = mChunks[ mReadChunk ];
+    const U8* data = &chunk[ mReadOffset ];
+    const U8* data_end = &chunk[ 0 ] + chunk.size();
+    U64 gap;
+    U64 width_and_bit;
+    if( !MiSpiReadVarint( data, data_end, gap ) || !MiSpiReadVarint( data, data_end, width_and_bit ) )
+        return false;
+    mReadOffset = data - &chunk[ 0 ];
+
+    start = mReadEnd + gap;
+    end = start + ( width_and_bit >> 1 );
+    bit = width_and_bit & 1;
+    mReadEnd = end;
+    return true;
+}
+
+void MiSpiPulseTimeline::Append( U64 start, U64 end, U64 bit )
+{
+    if( mChunks.empty() || mChunks.back().size() + MISPI_TIMELINE_MAX_PULSE_SIZE > MISPI_TIMELINE_CHUNK_SIZE )
+    {
+        mChunks.push_back( std::vector<U8>() );
+        mChunks.back().reserve( MISPI_TIMELINE_CHUNK_SIZE );
+    }
+
+    std::vector<U8>& chunk = mChunks.back();
+    MiSpiAppendVarint( chunk, start - mEnd );
+    MiSpiAppendVarint( chunk, ( ( end - start ) << 1 ) | bit );
+    mEnd = end;
+    mPulseCount++;
+}
+
+// Trailing edge of the last pulse
+U64 MiSpiPulseTimeline::GetEnd() const
+{
+    return mEnd;
+}
+
+U64 MiSpiPulseTimeline::GetPulseCount() const
+{
+    return mPulseCount;
+}
@@ -0,0 +1,49 @@
+#ifndef MISPI_PULSE_TIMELINE
+#define MISPI_PULSE_TIMELINE
+
+#include <AnalyzerTypes.h>
+#include <vector>
+
+// Number of pulses read from the channels and checked against the timeline before the rest is read from it
+#define MISPI_TIMELINE_CHECK_PULSES 64
+
+// Every clock pulse decoded so far, with the state of the data line at its trailing edge.
+//
+// Each pulse is two varints, the gap since the previous pulse ended and the pulse width shifted up one
+// with the data bit below it, so a bit pulse takes about three bytes. It outlives a decode, so when the
+// analyzer runs again over the same channels, say with another bit order or word width, the pulses are
+// read back from here and the channels are only walked past the end of what was seen before.
+class MiSpiPulseTimeline
+{
+  public:
+    MiSpiPulseTimeline();
+
+    // Keeps what's recorded if it's for the same channels and sample rate, and reads it from the start
+    void Prepare( const Channel& data, const Channel& clock, U64 sample_rate );
+    void Clear();
+
+    bool HasNext();
+    bool Read( U64& start, U64& end, U64& bit );
+    void Append( U64 start, U64 end, U64 bit );
+
+    U64 GetEnd() const;
+    U64 GetPulseCount() const;
+
+  protected:
+    Channel mDataChannel;
+    Channel mClockChannel;
+    U64 mSampleRate;
+
+    // Fixed size chunks so growing it never copies what's there, no pulse is split across two
+    std::vector<std::vector<U8> > mChunks;
+    U64 mEnd;
+    U64 mPulseCount;
+
+    // Reading stops for good at the end, anything appended after that is new to this decode
+    bool mReading;
+    size_t mReadChunk;
+    size_t mReadOffset;
+    U64 mReadEnd;
+};
+
+#endif // MISPI_PULSE_TIMELINE
@@ -81,9 +81,9 @@ void MiSpiSimulationDataGenerator::OutputInit( int direction )
 
 void MiSpiSimulationDataGenerator::OutputWord( U64 mispi_data )
 {
-    BitExtractor data_bits( mispi_data, mSettings->mShiftOrder, 8 );
+    BitExtractor data_bits( mispi_data, mSettings->mShiftOrder, mSettings->mBitsPerWord );
 
-    for( U32 i = 0; i < 8; i++ )
+    for( U32 i = 0; i < mSettings->mBitsPerWord; i++ )
     {
         mClock->Transition(); // data invalid
         mData->TransitionIfNeeded( data_bits.GetNextBit() );
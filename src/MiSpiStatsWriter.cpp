@@ -0,0 +1,102 @@
+#include "MiSpiStatsWriter.h"
+
+MiSpiStatsWriter::MiSpiStatsWriter( U64 sample_rate, const MiSpiTimingHistogram* timing )
+    : mSampleRate( sample_rate ), mSyncs( 0 ), mErrors( 0 )
+{
+    for( int i = 0; i < MiSpiTimingMetricCount; i++ )
+    {
+        mTiming[ i ] = timing[ i ];
+    }
+    for( int d = 0; d < 2; d++ )
+    {
+        mPackets[ d ] = 0;
+        mWords[ d ] = 0;
+        mRuns[ d ] = 0;
+        mLongestRun[ d ] = 0;
+    }
+}
+
+MiSpiStatsWriter::~MiSpiStatsWriter()
+{
+}
+
+void MiSpiStatsWriter::Close()
+{
+    if( mFile == NULL )
+        return;
+
+    std::stringstream ss;
+    ss << "Statistic,MOSI,MISO" << std::endl;
+    ss << "Packets," << mPackets[ MiSpiDirMosi ] << "," << mPackets[ MiSpiDirMiso ] << std::endl;
+    ss << "Words," << mWords[ MiSpiDirMosi ] << "," << mWords[ MiSpiDirMiso ] << std::endl;
+    ss << "Runs," << mRuns[ MiSpiDirMosi ] << "," << mRuns[ MiSpiDirMiso ] << std::endl;
+    ss << "Longest Run," << mLongestRun[ MiSpiDirMosi ] << "," << mLongestRun[ MiSpiDirMiso ] << std::endl;
+    ss << "Syncs," << mSyncs << std::endl;
+    ss << "Errors," << mErrors << std::endl;
+    ss << std::endl;
+    AppendTiming( ss, mTiming, mSampleRate );
+
+    Append( ss.str() );
+    MiSpiExportWriter::Close();
+}
+
+void MiSpiStatsWriter::WritePacket( MiSpiDirection direction, const std::vector<U64>& packet, U64 /*start_sample*/, U64 /*end_sample*/ )
+{
+    mPackets[ direction ]++;
+    mWords[ direction ] += packet.size();
+}
+
+void MiSpiStatsWriter::WriteRepeat( MiSpiDirection direction, const std::vector<U64>& packet, U64 count, U64 /*start_sample*/,
+                                    U64 /*end_sample*/ )
+{
+    mPackets[ direction ] += count;
+    mWords[ direction ] += count * packet.size();
+}
+
+void MiSpiStatsWriter::WriteLine( MiSpiDirection direction, const std::vector<U64>& /*packet*/, U64 repeats, U64 /*start_sample*/,
+                                  U64 /*end_sample*/ )
+{
+    mRuns[ direction ]++;
+    if( repeats > mLongestRun[ direction ] )
+        mLongestRun[ direction ] = repeats;
+}
+
+void MiSpiStatsWriter::WriteSync( U64 /*start_sample*/, U64 /*end_sample*/ )
+{
+    mSyncs++;
+}
+
+void MiSpiStatsWriter::WriteError( U64 /*start_sample*/, U64 /*end_sample*/ )
+{
+    mErrors++;
+}
+
+void MiSpiStatsWriter::AppendTiming( std::stringstream& ss, const MiSpiTimingHistogram* timing, U64 sample_rate )
+{
+    static const double percentiles[] = { 1, 50, 90, 99, 99.9 };
+    U32 num_percentiles = sizeof( percentiles ) / sizeof( percentiles[ 0 ] );
+    double us_per_sample = 1000000.0 / sample_rate;
+
+    ss << "Metric,Count,Min (us)";
+    for( U32 p = 0; p < num_percentiles; p++ )
+    {
+        ss << ",P" << percentiles[ p ] << " (us)";
+    }
+    ss << ",Max (us)" << std::endl;
+
+    for( int i = 0; i < MiSpiTimingMetricCount; i++ )
+    {
+        const MiSpiTimingHistogram& histogram = timing[ i ];
+        ss << MiSpiTimingHistogram::GetMetricName( ( MiSpiTimingMetric )i ) << "," << histogram.GetCount();
+        if( histogram.GetCount() > 0 )
+        {
+            ss << "," << histogram.GetMin() * us_per_sample;
+            for( U32 p = 0; p < num_percentiles; p++ )
+            {
+                ss << "," << histogram.GetPercentile( percentiles[ p ] ) * us_per_sample;
+            }
+            ss << "," << histogram.GetMax() * us_per_sample;
+        }
+        ss << std::endl;
+    }
+}
@@ -0,0 +1,38 @@
+#ifndef MISPI_STATS_WRITER
+#define MISPI_STATS_WRITER
+
+#include <AnalyzerTypes.h>
+#include "MiSpiExportWriter.h"
+#include "MiSpiTimingHistogram.h"
+#include <sstream>
+
+// A summary of the export, packet, word and run counts per direction, syncs and errors, followed
+// by the timing statistics. It's all counted as the packets go by and written on Close.
+class MiSpiStatsWriter : public MiSpiExportWriter
+{
+  public:
+    MiSpiStatsWriter( U64 sample_rate, const MiSpiTimingHistogram* timing );
+    virtual ~MiSpiStatsWriter();
+
+    virtual void Close();
+    virtual void WritePacket( MiSpiDirection direction, const std::vector<U64>& packet, U64 start_sample, U64 end_sample );
+    virtual void WriteRepeat( MiSpiDirection direction, const std::vector<U64>& packet, U64 count, U64 start_sample, U64 end_sample );
+    virtual void WriteLine( MiSpiDirection direction, const std::vector<U64>& packet, U64 repeats, U64 start_sample, U64 end_sample );
+    virtual void WriteSync( U64 start_sample, U64 end_sample );
+    virtual void WriteError( U64 start_sample, U64 end_sample );
+
+    // The table of the timing statistics export
+    static void AppendTiming( std::stringstream& ss, const MiSpiTimingHistogram* timing, U64 sample_rate );
+
+  protected:
+    U64 mSampleRate;
+    MiSpiTimingHistogram mTiming[ MiSpiTimingMetricCount ];
+    U64 mPackets[ 2 ];
+    U64 mWords[ 2 ];
+    U64 mRuns[ 2 ];
+    U64 mLongestRun[ 2 ];
+    U64 mSyncs;
+    U64 mErrors;
+};
+
+#endif // MISPI_STATS_WRITER
@@ -0,0 +1,136 @@
+#include "MiSpiTimeBase.h"
+
+#define MISPI_NS_PER_SECOND 1000000000ULL
+
+// Writes value in decimal with at least min_digits digits, returns the number written
+static U32 WriteDigits( U64 value, char* text, U32 min_digits )
+{
+    char digits[ 20 ];
+    U32 count = 0;
+    do
+    {
+        digits[ count++ ] = '0' + ( char )( value % 10 );
+        value /= 10;
+    } while( value != 0 );
+    while( count < min_digits )
+    {
+        digits[ count++ ] = '0';
+    }
+
+    for( U32 i = 0; i < count; i++ )
+    {
+        text[ i ] = digits[ count - 1 - i ];
+    }
+    return count;
+}
+
+MiSpiTimeBase::MiSpiTimeBase() : mUnit( MiSpiTimeNone ), mNsPerSample( 0 ), mNsPerSampleFraction( 0 ), mZeroNs( 0 )
+{
+}
+
+void MiSpiTimeBase::Init( U64 sample_rate, U64 zero_sample, MiSpiTimeUnit unit )
+{
+    mUnit = unit;
+
+    // Whole nanoseconds per sample, then the remainder as a binary fraction one bit at a time
+    mNsPerSample = MISPI_NS_PER_SECOND / sample_rate;
+    U64 remainder = MISPI_NS_PER_SECOND % sample_rate;
+    mNsPerSampleFraction = 0;
+    for( U32 i = 0; i < 64; i++ )
+    {
+        remainder <<= 1;
+        mNsPerSampleFraction <<= 1;
+        if( remainder >= sample_rate )
+        {
+            remainder -= sample_rate;
+            mNsPerSampleFraction |= 1;
+        }
+    }
+
+    mZeroNs = GetNs( zero_sample );
+}
+
+bool MiSpiTimeBase::IsEnabled() const
+{
+    return mUnit != MiSpiTimeNone;
+}
+
+const char* MiSpiTimeBase::GetUnitName() const
+{
+    switch( mUnit )
+    {
+    case MiSpiTimeSeconds:
+        return "s";
+    case MiSpiTimeMilliseconds:
+        return "ms";
+    case MiSpiTimeMicroseconds:
+        return "us";
+    case MiSpiTimeNanoseconds:
+        return "ns";
+    default:
+        return "";
+    }
+}
+
+U64 MiSpiTimeBase::GetNs( U64 sample ) const
+{
+    // Top half of the 128 bit product of the sample and the fraction, from 32 bit pieces
+    U64 sample_low = sample & 0xFFFFFFFF;
+    U64 sample_high = sample >> 32;
+    U64 fraction_low = mNsPerSampleFraction & 0xFFFFFFFF;
+    U64 fraction_high = mNsPerSampleFraction >> 32;
+
+    U64 low_low = sample_low * fraction_low;
+    U64 low_high = sample_low * fraction_high;
+    U64 high_low = sample_high * fraction_low;
+    U64 high_high = sample_high * fraction_high;
+
+    U64 middle = ( low_low >> 32 ) + ( low_high & 0xFFFFFFFF ) + ( high_low & 0xFFFFFFFF );
+    U64 product_low = ( middle << 32 ) | ( low_low & 0xFFFFFFFF );
+    U64 product_high = high_high + ( low_high >> 32 ) + ( high_low >> 32 ) + ( middle >> 32 );
+
+    // Rounded to the nearest nanosecond
+    return sample * mNsPerSample + product_high + ( product_low >> 63 );
+}
+
+// text needs room for 32 characters
+U32 MiSpiTimeBase::Format( U64 sample, char* text ) const
+{
+    U64 ns = GetNs( sample );
+    U32 length = 0;
+    U64 magnitude;
+    if( ns >= mZeroNs )
+    {
+        magnitude = ns - mZeroNs;
+    }
+    else
+    {
+        magnitude = mZeroNs - ns;
+        text[ length++ ] = '-';
+    }
+
+    switch( mUnit )
+    {
+    case MiSpiTimeSeconds:
+        length += WriteDigits( magnitude / 1000000000ULL, text + length, 1 );
+        text[ length++ ] = '.';
+        length += WriteDigits( magnitude % 1000000000ULL, text + length, 9 );
+        break;
+    case MiSpiTimeMilliseconds:
+        length += WriteDigits( magnitude / 1000000ULL, text + length, 1 );
+        text[ length++ ] = '.';
+        length += WriteDigits( magnitude % 1000000ULL, text + length, 6 );
+        break;
+    case MiSpiTimeMicroseconds:
+        length += WriteDigits( magnitude / 1000ULL, text + length, 1 );
+        text[ length++ ] = '.';
+        length += WriteDigits( magnitude % 1000ULL, text + length, 3 );
+        break;
+    default:
+        length += WriteDigits( magnitude, text + length, 1 );
+        break;
+    }
+
+    text[ length ] = '\0';
+    return length;
+}
@@ -0,0 +1,41 @@
+#ifndef MISPI_TIME_BASE
+#define MISPI_TIME_BASE
+
+#include <AnalyzerTypes.h>
+
+enum MiSpiTimeUnit {
+  MiSpiTimeNone,
+  MiSpiTimeSeconds,
+  MiSpiTimeMilliseconds,
+  MiSpiTimeMicroseconds,
+  MiSpiTimeNanoseconds
+};
+
+// Converts sample numbers to times without dividing by the sample rate for every one.
+//
+// Nanoseconds per sample is worked out once as a 64.64 fixed point number, so a conversion is a
+// 64 by 64 bit multiply done in 32 bit halves, rounded to the nearest nanosecond. Times are
+// written relative to a zero sample, normally the trigger, in the unit asked for.
+class MiSpiTimeBase
+{
+  public:
+    MiSpiTimeBase();
+
+    void Init( U64 sample_rate, U64 zero_sample, MiSpiTimeUnit unit );
+    bool IsEnabled() const;
+    const char* GetUnitName() const;
+
+    // Since the start of the capture
+    U64 GetNs( U64 sample ) const;
+
+    // Relative to the zero sample, in the unit, returns the number of characters written
+    U32 Format( U64 sample, char* text ) const;
+
+  protected:
+    MiSpiTimeUnit mUnit;
+    U64 mNsPerSample;
+    U64 mNsPerSampleFraction;
+    U64 mZeroNs;
+};
+
+#endif // MISPI_TIME_BASE
@@ -0,0 +1,214 @@
+#include "MiSpiTimingHistogram.h"
+#include "MiSpiVarint.h"
+
+#include <cstring>
+#if defined( _MSC_VER ) && defined( _M_X64 )
+#include <intrin.h>
+#endif
+
+MiSpiTimingHistogram::MiSpiTimingHistogram()
+{
+    Clear();
+}
+
+void MiSpiTimingHistogram::Add( U64 value )
+{
+    mBuckets[ GetBucket( value ) ]++;
+    if( mCount == 0 || value < mMin )
+        mMin = value;
+    if( mCount == 0 || value > mMax )
+        mMax = value;
+    mCount++;
+}
+
+void MiSpiTimingHistogram::Merge( const MiSpiTimingHistogram& other )
+{
+    if( other.mCount == 0 )
+        return;
+
+    for( U32 i = 0; i < BucketCount; i++ )
+    {
+        mBuckets[ i ] += other.mBuckets[ i ];
+    }
+    if( mCount == 0 || other.mMin < mMin )
+        mMin = other.mMin;
+    if( mCount == 0 || other.mMax > mMax )
+        mMax = other.mMax;
+    mCount += other.mCount;
+}
+
+void MiSpiTimingHistogram::Clear()
+{
+    memset( mBuckets, 0, sizeof( mBuckets ) );
+    mCount = 0;
+    mMin = 0;
+    mMax = 0;
+}
+
+U64 MiSpiTimingHistogram::GetCount() const
+{
+    return mCount;
+}
+
+U64 MiSpiTimingHistogram::GetMin() const
+{
+    return mMin;
+}
+
+U64 MiSpiTimingHistogram::GetMax() const
+{
+    return mMax;
+}
+
+// percentile is 0 to 100, the middle of the bucket it lands in is reported
+U64 MiSpiTimingHistogram::GetPercentile( double percentile ) const
+{
+    if( mCount == 0 )
+        return 0;
+
+    U64 rank = ( U64 )( percentile / 100.0 * mCount );
+    if( rank >= mCount )
+        rank = mCount - 1;
+
+    U64 seen = 0;
+    for( U32 i = 0; i < BucketCount; i++ )
+    {
+        seen += mBuckets[ i ];
+        if( seen > rank )
+        {
+            U64 low = GetBucketLow( i );
+            U64 value = low + ( GetBucketHigh( i ) - low ) / 2;
+            if( value < mMin )
+                value = mMin;
+            if( value > mMax )
+                value = mMax;
+            return value;
+        }
+    }
+    return mMax;
+}
+
+// Only the buckets in use are stored, as pairs of the distance from the previous one and the count
+void MiSpiTimingHistogram::Save( std::vector<U8>& data ) const
+{
+    U32 used = 0;
+    for( U32 i = 0; i < BucketCount; i++ )
+    {
+        if( mBuckets[ i ] != 0 )
+            used++;
+    }
+
+    MiSpiAppendVarint( data, mCount );
+    MiSpiAppendVarint( data, mMin );
+    MiSpiAppendVarint( data, mMax );
+    MiSpiAppendVarint( data, used );
+
+    U32 previous = 0;
+    for( U32 i = 0; i < BucketCount; i++ )
+    {
+        if( mBuckets[ i ] == 0 )
+            continue;
+        MiSpiAppendVarint( data, i - previous );
+        MiSpiAppendVarint( data, mBuckets[ i ] );
+        previous = i;
+    }
+}
+
+bool MiSpiTimingHistogram::Load( const U8*& data, const U8* end )
+{
+    Clear();
+
+    U64 used;
+    if( !MiSpiReadVarint( data, end, mCount ) || !MiSpiReadVarint( data, end, mMin ) || !MiSpiReadVarint( data, end, mMax ) ||
+        !MiSpiReadVarint( data, end, used ) )
+        return false;
+
+    U64 bucket = 0;
+    for( U64 i = 0; i < used; i++ )
+    {
+        U64 distance;
+        U64 count;
+        if( !MiSpiReadVarint( data, end, distance ) || !MiSpiReadVarint( data, end, count ) )
+            return false;
+        bucket += distance;
+        if( bucket >= BucketCount )
+            return false;
+        mBuckets[ bucket ] = count;
+    }
+    return true;
+}
+
+const char* MiSpiTimingHistogram::GetMetricName( MiSpiTimingMetric metric )
+{
+    switch( metric )
+    {
+    case MiSpiTimingBitPulse:
+        return "Bit pulse";
+    case MiSpiTimingMosiStartPulse:
+        return "MOSI start pulse";
+    case MiSpiTimingMisoStartPulse:
+        return "MISO start pulse";
+    case MiSpiTimingSyncPulse:
+        return "Sync pulse";
+    case MiSpiTimingWordGap:
+        return "Inter-word gap";
+    case MiSpiTimingPacketGap:
+        return "Inter-packet gap";
+    default:
+        return "Unknown";
+    }
+}
+
+// Position of the leading one, value isn't 0
+static U32 GetLeadingBit( U64 value )
+{
+#if defined( __GNUC__ )
+    return 63 - __builtin_clzll( value );
+#elif defined( _MSC_VER ) && defined( _M_X64 )
+    unsigned long index;
+    _BitScanReverse64( &index, value );
+    return index;
+#else
+    // Six halvings whatever the value
+    U32 bit = 0;
+    for( U32 shift = 32; shift > 0; shift >>= 1 )
+    {
+        if( ( value >> shift ) != 0 )
+        {
+            value >>= shift;
+            bit += shift;
+        }
+    }
+    return bit;
+#endif
+}
+
+// Runs for every pulse, so the bucket comes straight from the leading one and the bits below it
+U32 MiSpiTimingHistogram::GetBucket( U64 value )
+{
+    if( value < ExactBuckets )
+        return value;
+
+    U32 exponent = GetLeadingBit( value );
+    U32 sub_bucket = ( value >> ( exponent - SubBucketBits ) ) & ( SubBuckets - 1 );
+    return ExactBuckets + ( exponent - 5 ) * SubBuckets + sub_bucket;
+}
+
+U64 MiSpiTimingHistogram::GetBucketLow( U32 bucket )
+{
+    if( bucket < ExactBuckets )
+        return bucket;
+
+    U32 exponent = ( bucket - ExactBuckets ) / SubBuckets + 5;
+    U64 sub_bucket = ( bucket - ExactBuckets ) % SubBuckets;
+    return ( 1ULL << exponent ) + ( sub_bucket << ( exponent - SubBucketBits ) );
+}
+
+U64 MiSpiTimingHistogram::GetBucketHigh( U32 bucket )
+{
+    if( bucket < ExactBuckets )
+        return bucket;
+
+    U32 exponent = ( bucket - ExactBuckets ) / SubBuckets + 5;
+    return GetBucketLow( bucket ) + ( 1ULL << ( exponent - SubBucketBits ) ) - 1;
+}
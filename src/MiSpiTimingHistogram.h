@@ -0,0 +1,58 @@
+#ifndef MISPI_TIMING_HISTOGRAM
+#define MISPI_TIMING_HISTOGRAM
+
+#include <AnalyzerTypes.h>
+#include <vector>
+
+enum MiSpiTimingMetric {
+  MiSpiTimingBitPulse,
+  MiSpiTimingMosiStartPulse,
+  MiSpiTimingMisoStartPulse,
+  MiSpiTimingSyncPulse,
+  MiSpiTimingWordGap,
+  MiSpiTimingPacketGap,
+  MiSpiTimingMetricCount
+};
+
+// Histogram of durations in samples with a fixed number of log spaced buckets.
+//
+// Values below 32 get a bucket each, above that every power of two is split into 16 buckets,
+// so a percentile is within about 3% of the true value whatever the capture length.
+class MiSpiTimingHistogram
+{
+  public:
+    MiSpiTimingHistogram();
+
+    void Add( U64 value );
+    void Merge( const MiSpiTimingHistogram& other );
+    void Clear();
+
+    U64 GetCount() const;
+    U64 GetMin() const;
+    U64 GetMax() const;
+    U64 GetPercentile( double percentile ) const;
+
+    void Save( std::vector<U8>& data ) const;
+    bool Load( const U8*& data, const U8* end );
+
+    static const char* GetMetricName( MiSpiTimingMetric metric );
+
+  protected:
+    enum {
+        ExactBuckets = 32,
+        SubBucketBits = 4,
+        SubBuckets = 1 << SubBucketBits,
+        BucketCount = ExactBuckets + ( 64 - 5 ) * SubBuckets
+    };
+
+    static U32 GetBucket( U64 value );
+    static U64 GetBucketLow( U32 bucket );
+    static U64 GetBucketHigh( U32 bucket );
+
+    U64 mBuckets[ BucketCount ];
+    U64 mCount;
+    U64 mMin;
+    U64 mMax;
+};
+
+#endif // MISPI_TIMING_HISTOGRAM
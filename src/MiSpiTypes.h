@@ -0,0 +1,37 @@
+#ifndef MISPI_TYPES
+#define MISPI_TYPES
+
+#include <AnalyzerTypes.h>
+#include <vector>
+
+enum MiSpiDirection {
+  MiSpiDirMiso,
+  MiSpiDirMosi,
+  MiSpiDirUnknown
+};
+
+struct MiSpiWord
+{
+    U64 mData;
+    U64 mStartingSampleInclusive;
+    U64 mEndingSampleInclusive;
+};
+
+// A clock pulse, with the state of the data line at its trailing edge
+struct MiSpiPulse
+{
+    U64 mStartingSampleInclusive;
+    U64 mEndingSampleInclusive;
+    U64 mBit;
+};
+
+// Packet payloads are the words in big endian byte order, whatever their width
+inline void MiSpiAppendWordBytes( std::vector<U8>& bytes, U64 word, U32 bits_per_word )
+{
+    for( S32 shift = bits_per_word - 8; shift >= 0; shift -= 8 )
+    {
+        bytes.push_back( ( U8 )( word >> shift ) );
+    }
+}
+
+#endif // MISPI_TYPES
@@ -0,0 +1,44 @@
+#ifndef MISPI_VARINT
+#define MISPI_VARINT
+
+#include <AnalyzerTypes.h>
+#include <vector>
+
+// Little endian base 128 varints, 7 bits per byte with the top bit set on all but the last byte.
+// Signed values are zigzag encoded first so small negative deltas stay short too.
+inline void MiSpiAppendVarint( std::vector<U8>& data, U64 value )
+{
+    while( value >= 0x80 )
+    {
+        data.push_back( ( U8 )( value | 0x80 ) );
+        value >>= 7;
+    }
+    data.push_back( ( U8 )value );
+}
+
+inline bool MiSpiReadVarint( const U8*& data, const U8* end, U64& value )
+{
+    value = 0;
+    for( U32 shift = 0; shift < 64; shift += 7 )
+    {
+        if( data == end )
+            return false;
+        U8 byte = *data++;
+        value |= ( U64 )( byte & 0x7F ) << shift;
+        if( ( byte & 0x80 ) == 0 )
+            return true;
+    }
+    return false;
+}
+
+inline U64 MiSpiZigZag( S64 value )
+{
+    return ( ( U64 )value << 1 ) ^ ( U64 )( value >> 63 );
+}
+
+inline S64 MiSpiUnZigZag( U64 value )
+{
+    return ( S64 )( value >> 1 ) ^ -( S64 )( value & 1 );
+}
+
+#endif // MISPI_VARINT